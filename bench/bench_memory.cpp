@@ -0,0 +1,112 @@
+// Throughput of the testbench memory (tests/memory.cpp): Memory::read and
+// Memory::write directly, and the DPI entry points (handle and scoped).
+// Prints one line per benchmark:
+//   BENCH name=<name> ops=N seconds=S mops=M
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "memory.h"
+
+using namespace std;
+
+static volatile uint32_t sink;
+
+template <typename Fn>
+static void bench(const char* name, uint64_t ops, Fn fn) {
+    auto start = chrono::steady_clock::now();
+    fn();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("BENCH name=%s ops=%llu seconds=%.3f mops=%.2f\n", name,
+           static_cast<unsigned long long>(ops), seconds,
+           seconds > 0 ? ops / seconds / 1e6 : 0.0);
+}
+
+// Addresses from a fixed LCG, spread over a 16 MiB working set
+static uint32_t next_addr(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return (state >> 8) & 0xFFFFFC;
+}
+
+int main(int argc, char** argv) {
+    // Options:
+    //   --ops N    operations per benchmark (default 20000000)
+    uint64_t ops = 20000000;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--ops" && i + 1 < argc) {
+            ops = strtoull(argv[++i], nullptr, 0);
+        }
+    }
+
+    Memory mem;
+    bench("mem_write_seq", ops, [&]() {
+        for (uint64_t i = 0; i < ops; i++) {
+            mem.write(static_cast<uint32_t>(i << 2) & 0xFFFFFC, static_cast<uint32_t>(i), 0xF);
+        }
+    });
+    bench("mem_read_seq", ops, [&]() {
+        uint32_t acc = 0;
+        for (uint64_t i = 0; i < ops; i++) {
+            acc += mem.read(static_cast<uint32_t>(i << 2) & 0xFFFFFC);
+        }
+        sink = acc;
+    });
+    bench("mem_write_rand", ops, [&]() {
+        uint32_t state = 1;
+        for (uint64_t i = 0; i < ops; i++) {
+            mem.write(next_addr(state), static_cast<uint32_t>(i), 1u << (i & 3));
+        }
+    });
+    bench("mem_read_rand", ops, [&]() {
+        uint32_t state = 1;
+        uint32_t acc = 0;
+        for (uint64_t i = 0; i < ops; i++) {
+            acc += mem.read(next_addr(state));
+        }
+        sink = acc;
+    });
+
+    // Two instances used in turn on one thread, as the golden model's
+    // memory and the DUT's are in co-simulation
+    Memory other;
+    for (uint32_t a = 0; a < 0x1000000; a += 4) other.write(a, a, 0xF);
+    bench("mem_read_interleaved", ops, [&]() {
+        uint32_t acc = 0;
+        for (uint64_t i = 0; i < ops; i++) {
+            uint32_t addr = static_cast<uint32_t>(i << 1) & 0xFFFFFC;
+            acc += (i & 1) ? other.read(addr) : mem.read(addr);
+        }
+        sink = acc;
+    });
+
+    // DPI paths: no scope bound, so calls go to Memory::global().
+    // The RTL uses the handle functions; the scoped ones are the old path.
+    void* handle = mem_attach("/dev/null");
+    bench("dpi_read_handle", ops, [&]() {
+        uint32_t acc = 0;
+        for (uint64_t i = 0; i < ops; i++) {
+            acc += static_cast<uint32_t>(mem_read_h(handle, static_cast<int>((i << 2) & 0xFFFFFC)));
+        }
+        sink = acc;
+    });
+    bench("dpi_write_handle", ops, [&]() {
+        for (uint64_t i = 0; i < ops; i++) {
+            mem_write_h(handle, static_cast<int>((i << 2) & 0xFFFFFC), static_cast<int>(i), 0xF);
+        }
+    });
+    bench("dpi_read_seq", ops, [&]() {
+        uint32_t acc = 0;
+        for (uint64_t i = 0; i < ops; i++) {
+            acc += static_cast<uint32_t>(mem_read(static_cast<int>((i << 2) & 0xFFFFFC)));
+        }
+        sink = acc;
+    });
+    bench("dpi_write_seq", ops, [&]() {
+        for (uint64_t i = 0; i < ops; i++) {
+            mem_write(static_cast<int>((i << 2) & 0xFFFFFC), static_cast<int>(i), 0xF);
+        }
+    });
+    return 0;
+}
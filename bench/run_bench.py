@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+"""
+Simulation throughput benchmarks, compared against a stored baseline
+Generates a set of synthetic programs and measures:
+  golden.<prog>   golden model instructions/s   (core_tb --golden-only)
+  rtl.<prog>      Vcore cycles/s, no tracing    (core_tb --rtl-only)
+  rtl_vcd.<prog>  Vcore cycles/s, full VCD      (core_tb --rtl-only --trace)
+  cosim.<prog>    checked cycles/s              (core_tb)
+  mem.<name>      memory ops/s                  (bench_memory)
+All metrics are higher-is-better. Results are compared against
+bench/baseline.json; a metric more than --tolerance below its baseline
+counts as a regression. Baselines are machine-specific: record one with
+--update-baseline on the reference host and commit it.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'baseline.json')
+
+# ---------------------------------------------------------------------------
+# Encoders for the instructions the benchmarks use
+# ---------------------------------------------------------------------------
+
+def s_type(funct3, rs2, rs1, imm):
+    return (((imm >> 5) & 0x7F) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | \
+           ((imm & 0x1F) << 7) | 0x23
+
+def addi(rd, rs1, imm): return ((imm & 0xFFF) << 20) | (rs1 << 15) | (rd << 7) | 0x13
+def add(rd, rs1, rs2):  return (rs2 << 20) | (rs1 << 15) | (rd << 7) | 0x33
+def lui(rd, imm20):     return ((imm20 & 0xFFFFF) << 12) | (rd << 7) | 0x37
+def lw(rd, rs1, imm):   return ((imm & 0xFFF) << 20) | (rs1 << 15) | (0b010 << 12) | (rd << 7) | 0x03
+def lbu(rd, rs1, imm):  return ((imm & 0xFFF) << 20) | (rs1 << 15) | (0b100 << 12) | (rd << 7) | 0x03
+def sw(rs2, rs1, imm):  return s_type(0b010, rs2, rs1, imm)
+def sb(rs2, rs1, imm):  return s_type(0b000, rs2, rs1, imm)
+def jalr(rd, rs1, imm): return ((imm & 0xFFF) << 20) | (rs1 << 15) | (rd << 7) | 0x67
+
+def loop(setup, body):
+    """setup, then body repeated forever; x1 holds the loop address"""
+    start = 4 * (len(setup) + 1)
+    return setup + [addi(1, 0, start)] + body + [jalr(0, 1, 0)]
+
+def prog_alu():
+    """Register-only ALU loop"""
+    body = []
+    for i in range(32):
+        rd = 2 + i % 12
+        body.append(add(rd, rd, 2 + (i + 5) % 12) if i % 2 else addi(rd, rd, i + 1))
+    return loop([], body)
+
+def prog_mem():
+    """Streaming loads and stores through a pointer walking up from 1 MiB"""
+    setup = [lui(2, 0x100)]
+    body = []
+    for _ in range(8):
+        body += [lw(3, 2, 0), lbu(4, 2, 1), addi(3, 3, 1), sw(3, 2, 4), sb(4, 2, 9), addi(2, 2, 16)]
+    return loop(setup, body)
+
+def prog_call():
+    """Call/return through a chain of small subroutines"""
+    # 0: jump over the subroutines to main
+    # sub k at 8 + 12k: addi x5, x5, k; add x6, x6, x5; jalr x0, 0(x7)
+    nsubs = 8
+    main = 8 + 12 * nsubs
+    words = [addi(8, 0, main), jalr(0, 8, 0)]
+    for k in range(nsubs):
+        words += [addi(5, 5, k + 1), add(6, 6, 5), jalr(0, 7, 0)]
+    # main: for each sub, x9 = sub address, call with return address in x7
+    for k in range(nsubs):
+        words += [addi(9, 0, 8 + 12 * k), jalr(7, 9, 0)]
+    words += [jalr(0, 8, 0)]
+    return words
+
+def prog_mixed():
+    """ALU, memory and jumps in roughly even parts"""
+    setup = [lui(2, 0x200), addi(10, 0, 0)]
+    body = []
+    for i in range(8):
+        body += [addi(3, 3, i), add(4, 4, 3), sw(4, 2, 8), lw(5, 2, 12), lbu(6, 2, 13), addi(2, 2, 4)]
+    return loop(setup, body)
+
+PROGRAMS = {
+    'alu': prog_alu,
+    'mem': prog_mem,
+    'call': prog_call,
+    'mixed': prog_mixed,
+}
+
+def write_hex(words, path):
+    with open(path, 'w') as f:
+        for w in words:
+            f.write(f"{w:08x}\n")
+
+# ---------------------------------------------------------------------------
+
+def run(cmd, cwd):
+    proc = subprocess.run(cmd, cwd=cwd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                          text=True, errors='replace')
+    if proc.returncode != 0:
+        print(proc.stdout)
+        raise RuntimeError(f"{' '.join(cmd)} exited with {proc.returncode}")
+    return proc.stdout
+
+def result_rate(output):
+    """cycles/s from core_tb's RESULT line"""
+    for line in reversed(output.splitlines()):
+        if line.startswith('RESULT '):
+            fields = dict(kv.split('=', 1) for kv in line.split()[1:] if '=' in kv)
+            seconds = float(fields['seconds'])
+            return int(fields['cycles']) / seconds if seconds > 0 else 0.0
+    raise RuntimeError("no RESULT line in core_tb output")
+
+def best_of(repeat, fn):
+    return max(fn() for _ in range(repeat))
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('--tb', default='obj_dir/Vcore', help='core_tb executable')
+    parser.add_argument('--mem-bench', default='obj_dir/bench_memory', help='bench_memory executable')
+    parser.add_argument('--golden-instrs', type=int, default=20000000)
+    parser.add_argument('--rtl-cycles', type=int, default=2000000)
+    parser.add_argument('--trace-cycles', type=int, default=200000)
+    parser.add_argument('--mem-ops', type=int, default=20000000)
+    parser.add_argument('--repeat', type=int, default=3, help='runs per metric, best kept')
+    parser.add_argument('--only', help='comma-separated metric prefixes (golden,rtl,rtl_vcd,cosim,mem)')
+    parser.add_argument('--baseline', default=BASELINE)
+    parser.add_argument('--tolerance', type=float, default=0.10, help='allowed slowdown (default 0.10)')
+    parser.add_argument('--update-baseline', action='store_true')
+    parser.add_argument('--json', help='write results as JSON')
+    args = parser.parse_args()
+
+    only = set(args.only.split(',')) if args.only else None
+    def wanted(kind):
+        return only is None or kind in only
+
+    tb = os.path.abspath(args.tb)
+    results = {}
+    with tempfile.TemporaryDirectory(prefix='rv5_bench_') as work:
+        if any(wanted(k) for k in ('golden', 'rtl', 'rtl_vcd', 'cosim')):
+            if not os.access(tb, os.X_OK):
+                print(f"Error: testbench {args.tb} not found or not executable")
+                sys.exit(2)
+            for name, gen in PROGRAMS.items():
+                image = os.path.join(work, f"{name}.hex")
+                write_hex(gen(), image)
+                runs = [
+                    ('golden', ['--golden-only', '--cycles', str(args.golden_instrs)]),
+                    ('rtl', ['--rtl-only', '--cycles', str(args.rtl_cycles)]),
+                    ('rtl_vcd', ['--rtl-only', '--trace', '--cycles', str(args.trace_cycles)]),
+                    ('cosim', ['--cycles', str(args.rtl_cycles)]),
+                ]
+                for kind, opts in runs:
+                    if not wanted(kind):
+                        continue
+                    cmd = [tb, '--image', image] + opts
+                    results[f"{kind}.{name}"] = best_of(args.repeat, lambda: result_rate(run(cmd, work)))
+
+        if wanted('mem'):
+            mem_bench = os.path.abspath(args.mem_bench)
+            if not os.access(mem_bench, os.X_OK):
+                print(f"Error: {args.mem_bench} not found or not executable")
+                sys.exit(2)
+            for _ in range(args.repeat):
+                out = run([mem_bench, '--ops', str(args.mem_ops)], work)
+                for line in out.splitlines():
+                    if not line.startswith('BENCH '):
+                        continue
+                    fields = dict(kv.split('=', 1) for kv in line.split()[1:])
+                    key = f"mem.{fields['name']}"
+                    rate = float(fields['mops']) * 1e6
+                    results[key] = max(results.get(key, 0.0), rate)
+
+    baseline = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline, 'r') as f:
+            baseline = json.load(f)
+
+    print("=" * 80)
+    print(f"{'metric':<28}{'per second':>16}{'baseline':>16}{'change':>12}")
+    print("=" * 80)
+    regressions = 0
+    for key in sorted(results):
+        value = results[key]
+        line = f"{key:<28}{value:>16,.0f}"
+        if key in baseline and baseline[key] > 0:
+            change = value / baseline[key] - 1.0
+            mark = ""
+            if change < -args.tolerance:
+                mark = " ❌"
+                regressions += 1
+            line += f"{baseline[key]:>16,.0f}{change:>+11.1%}{mark}"
+        print(line)
+
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+    if args.update_baseline:
+        baseline.update({k: round(v, 1) for k, v in results.items()})
+        with open(args.baseline, 'w') as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+            f.write('\n')
+        print(f"Baseline updated: {args.baseline}")
+    elif regressions:
+        print(f"\n{regressions} metric(s) regressed by more than {args.tolerance:.0%}")
+        sys.exit(1)
+    elif not baseline:
+        print("\nNo baseline yet; record one with --update-baseline")
+
+if __name__ == '__main__':
+    main()
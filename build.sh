@@ -0,0 +1,82 @@
+#!/usr/bin/env bash
+# Build the core testbench (OUT/Vcore) and the memory benchmark
+# (OUT/bench_memory) with Verilator.
+#
+#   ./build.sh [OUT]                      single-threaded model in obj_dir
+#   THREADS=4 ./build.sh obj_dir_mt       multithreaded model
+#   CORE=pipe ./build.sh obj_dir_pipe     five-stage pipelined core
+#   DCACHE_SIZE=1024 MISS_LATENCY=20 ./build.sh obj_dir_small
+#
+# Environment:
+#   THREADS=N    Verilator --threads N (default 1). With N > 1 the model's
+#                eval is partitioned across N threads and built with
+#                --threads-dpi all, so the DPI memory calls (none are
+#                pure) aren't serialized; tests/memory.cpp is safe for
+#                concurrent reads and writes.
+#   TRACE=vcd|fst|none   waveform support compiled in (default vcd)
+#   CFLAGS       C++ optimization flags for the model (default -O2)
+#   CORE=core|pipe   single-cycle core.sv (default) or pipelined
+#                core_pipe.sv; both build as Vcore, and core_tb checks
+#                either one at retirement
+#   ICACHE_SIZE, ICACHE_WAYS, ICACHE_LINE, DCACHE_SIZE, DCACHE_WAYS,
+#   DCACHE_LINE, DCACHE_WRITE_BACK (1 or 0), MISS_LATENCY
+#                cache geometry and timing (see rtl/cache.sv; defaults in
+#                rtl/core.sv). Each one set is passed to Verilator as a
+#                parameter and to core_tb as a define, so the golden
+#                model's cache models match the RTL's.
+#
+# Comparing the two builds:
+#   ./build.sh obj_dir
+#   THREADS=4 ./build.sh obj_dir_mt
+#   bench/run_bench.py --tb obj_dir/Vcore --only rtl,cosim --update-baseline \
+#       --baseline /tmp/st.json
+#   bench/run_bench.py --tb obj_dir_mt/Vcore --only rtl,cosim --baseline /tmp/st.json
+# The second run reports the multithreaded build's change against the
+# single-threaded one per program. With a core this small, scheduling and
+# synchronization overhead can outweigh the partitioning; more threads
+# only pay off once the design has enough independent logic per cycle.
+set -euo pipefail
+
+cd "$(dirname "$0")"
+OUT=${1:-obj_dir}
+THREADS=${THREADS:-1}
+TRACE=${TRACE:-vcd}
+CFLAGS=${CFLAGS:--O2}
+CORE=${CORE:-core}
+
+case "$CORE" in
+    core) TOP=core; DEFS="" ;;
+    pipe) TOP=core_pipe; DEFS="-DCORE_PIPE" ;;
+    *) echo "Error: CORE must be core or pipe" >&2; exit 1 ;;
+esac
+
+GFLAGS=()
+for p in ICACHE_SIZE ICACHE_WAYS ICACHE_LINE DCACHE_SIZE DCACHE_WAYS DCACHE_LINE \
+         DCACHE_WRITE_BACK MISS_LATENCY; do
+    if [ -n "${!p:-}" ]; then
+        GFLAGS+=("-G$p=${!p}")
+        DEFS="$DEFS -D$p=${!p}"
+    fi
+done
+
+VFLAGS=(--cc --exe --build -j 0 -Wno-fatal --top-module "$TOP" --prefix Vcore -Mdir "$OUT"
+        -CFLAGS "$CFLAGS -std=c++17 $DEFS" -LDFLAGS -pthread)
+case "$TRACE" in
+    vcd) VFLAGS+=(--trace) ;;
+    fst) VFLAGS+=(--trace-fst --trace-threads 1) ;;
+    none) ;;
+    *) echo "Error: TRACE must be vcd, fst or none" >&2; exit 1 ;;
+esac
+if [ "$THREADS" -gt 1 ]; then
+    VFLAGS+=(--threads "$THREADS" --threads-dpi all)
+fi
+
+verilator "${VFLAGS[@]}" ${GFLAGS[@]+"${GFLAGS[@]}"} -o Vcore rtl/*.sv tests/core_tb.cpp tests/memory.cpp
+
+# bench_memory only needs the svdpi scope API from the Verilator runtime
+VROOT=$(verilator --getenv VERILATOR_ROOT)
+c++ $CFLAGS -std=c++17 -pthread -I"$VROOT/include" -I"$VROOT/include/vltstd" -Itests \
+    -o "$OUT/bench_memory" bench/bench_memory.cpp tests/memory.cpp \
+    "$OUT/libverilated.a"
+
+echo "Built $OUT/Vcore (core=$CORE, threads=$THREADS, trace=$TRACE) and $OUT/bench_memory"
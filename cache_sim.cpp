@@ -0,0 +1,243 @@
+/**
+ * Trace-driven cache simulator: reads a memory-access trace written by
+ * core_tb --mem-trace (format in tests/mem_trace.h) and reports hits and
+ * misses of many I-cache and D-cache configurations in a single pass.
+ *
+ *   cache_sim TRACE [--sizes LIST] [--ways LIST] [--lines LIST] [--csv PATH]
+ *
+ * LISTs are comma-separated byte counts, with an optional K suffix
+ * (default sizes 256,512,1K,...,64K, ways 1,2,4,8,16, lines 16,32,64).
+ * Every combination that makes a power-of-two number of sets is
+ * simulated. Fetches go to the I-cache, loads and stores to the D-cache.
+ *
+ * Caches are LRU and allocate on every miss, as rtl/cache.sv with
+ * WRITE_BACK=1: for such a configuration the hits and misses equal
+ * tests/cache_model.h's. Write-through (no write-allocate) caches and
+ * write-back counts are not modelled.
+ *
+ * LRU caches have the inclusion property: an access that hits with N
+ * ways also hits with more. So for each line size and set count one LRU
+ * stack per set, as deep as the most ways asked for, gives the stack
+ * distance of every access, and a histogram of those distances gives
+ * the hits of every associativity at once.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "tests/mem_trace.h"
+
+using namespace std;
+
+// LRU stacks for one line size and set count
+class StackGroup {
+public:
+    StackGroup(uint32_t line_bytes, uint32_t sets, uint32_t depth)
+        : line_bytes(line_bytes), sets(sets), depth(depth),
+          line_bits(log2(line_bytes)), stacks(sets * depth), fill(sets, 0), hist(depth + 1, 0) {}
+
+    void access(uint32_t addr) {
+        uint32_t block = addr >> line_bits;
+        uint32_t set = block & (sets - 1);
+        uint32_t* stack = &stacks[set * depth];
+        uint32_t n = fill[set];
+        uint32_t i = 0;
+        while (i < n && stack[i] != block) i++;
+        // Distance i: hits with more than i ways. Not found: misses in all.
+        hist[i < n ? i : depth]++;
+        if (i == n) {
+            if (n < depth) fill[set]++;
+            else i = depth - 1;
+        }
+        memmove(stack + 1, stack, i * sizeof(uint32_t));
+        stack[0] = block;
+    }
+
+    uint64_t hits(uint32_t ways) const {
+        uint64_t n = 0;
+        for (uint32_t d = 0; d < ways; d++) n += hist[d];
+        return n;
+    }
+
+    uint32_t line_bytes, sets, depth;
+
+private:
+    uint32_t line_bits;
+    vector<uint32_t> stacks;    // depth blocks per set, most recent first
+    vector<uint32_t> fill;      // valid entries per set
+    vector<uint64_t> hist;      // accesses per stack distance; [depth] = deeper
+
+    static uint32_t log2(uint32_t v) {
+        uint32_t n = 0;
+        while ((1u << n) < v) n++;
+        return n;
+    }
+};
+
+struct Config {
+    uint32_t size, ways, line, sets;
+    int group;                  // index into the I and D group lists
+};
+
+static bool pow2(uint32_t v) { return v && !(v & (v - 1)); }
+
+// "256,1K,4k" -> {256, 1024, 4096}
+static bool parse_list(const char* arg, vector<uint32_t>& out) {
+    out.clear();
+    string s(arg);
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        size_t comma = s.find(',', pos);
+        string item = s.substr(pos, comma == string::npos ? string::npos : comma - pos);
+        char* end = nullptr;
+        unsigned long v = strtoul(item.c_str(), &end, 10);
+        if (end && (*end == 'K' || *end == 'k')) {
+            v *= 1024;
+            end++;
+        }
+        if (item.empty() || !end || *end || !pow2(static_cast<uint32_t>(v))) {
+            cerr << "Error: '" << item << "' is not a power-of-two count" << endl;
+            return false;
+        }
+        out.push_back(static_cast<uint32_t>(v));
+        if (comma == string::npos) break;
+        pos = comma + 1;
+    }
+    return !out.empty();
+}
+
+static double percent(uint64_t part, uint64_t total) {
+    return total ? 100.0 * part / total : 0.0;
+}
+
+int main(int argc, char** argv) {
+    vector<uint32_t> sizes = {256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536};
+    vector<uint32_t> ways = {1, 2, 4, 8, 16};
+    vector<uint32_t> lines = {16, 32, 64};
+    const char* trace_path = nullptr;
+    const char* csv_path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc) {
+            if (!parse_list(argv[++i], sizes)) return 1;
+        } else if (arg == "--ways" && i + 1 < argc) {
+            if (!parse_list(argv[++i], ways)) return 1;
+        } else if (arg == "--lines" && i + 1 < argc) {
+            if (!parse_list(argv[++i], lines)) return 1;
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (!trace_path && arg[0] != '-') {
+            trace_path = argv[i];
+        } else {
+            cerr << "Usage: " << argv[0]
+                 << " TRACE [--sizes LIST] [--ways LIST] [--lines LIST] [--csv PATH]" << endl;
+            return 1;
+        }
+    }
+    if (!trace_path) {
+        cerr << "Usage: " << argv[0]
+             << " TRACE [--sizes LIST] [--ways LIST] [--lines LIST] [--csv PATH]" << endl;
+        return 1;
+    }
+
+    // One stack group per (line size, set count), deep enough for the
+    // most ways any configuration in it has. I and D use the same layout.
+    vector<Config> configs;
+    vector<StackGroup> igroups, dgroups;
+    for (uint32_t line : lines) {
+        for (uint32_t size : sizes) {
+            for (uint32_t w : ways) {
+                if (size < w * line) continue;
+                uint32_t sets = size / (w * line);
+                int g = 0;
+                while (g < static_cast<int>(igroups.size()) &&
+                       (igroups[g].line_bytes != line || igroups[g].sets != sets)) {
+                    g++;
+                }
+                if (g == static_cast<int>(igroups.size())) {
+                    igroups.emplace_back(line, sets, 0);
+                }
+                configs.push_back({size, w, line, sets, g});
+            }
+        }
+    }
+    if (configs.empty()) {
+        cerr << "Error: no size/ways/line combination fits" << endl;
+        return 1;
+    }
+    for (StackGroup& g : igroups) {
+        uint32_t depth = 0;
+        for (const Config& c : configs) {
+            if (igroups[c.group].line_bytes == g.line_bytes && igroups[c.group].sets == g.sets &&
+                c.ways > depth) {
+                depth = c.ways;
+            }
+        }
+        g = StackGroup(g.line_bytes, g.sets, depth);
+        dgroups.push_back(g);
+    }
+
+    MemTraceReader reader;
+    if (!reader.open(trace_path)) return 1;
+    auto start = chrono::steady_clock::now();
+    uint64_t fetches = 0, loads = 0, stores = 0;
+    MemAccess a;
+    while (reader.next(a)) {
+        if (a.kind == MEM_FETCH) {
+            fetches++;
+            for (StackGroup& g : igroups) g.access(a.addr);
+        } else {
+            (a.kind == MEM_LOAD ? loads : stores)++;
+            for (StackGroup& g : dgroups) g.access(a.addr);
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    uint64_t data = loads + stores;
+    cout << dec << fetches << " fetches, " << loads << " loads, " << stores << " stores; "
+         << configs.size() << " configurations (" << igroups.size()
+         << " stack groups per cache) in " << fixed << setprecision(3) << seconds << " s"
+         << endl;
+    // MPKI: misses per 1000 instructions (one fetch per instruction)
+    cout << "\n   size ways line  sets |  I hit%   I MPKI |  D hit%   D MPKI" << endl;
+    for (const Config& c : configs) {
+        uint64_t ihits = igroups[c.group].hits(c.ways);
+        uint64_t dhits = dgroups[c.group].hits(c.ways);
+        cout << setw(7) << c.size << setw(5) << c.ways << setw(5) << c.line << setw(6) << c.sets
+             << " | " << setprecision(2) << setw(7) << percent(ihits, fetches) << setw(9)
+             << (fetches ? 1000.0 * (fetches - ihits) / fetches : 0.0) << " | " << setw(7)
+             << percent(dhits, data) << setw(9)
+             << (fetches ? 1000.0 * (data - dhits) / fetches : 0.0) << endl;
+    }
+
+    if (csv_path) {
+        FILE* fp = fopen(csv_path, "w");
+        if (!fp) {
+            perror("cache_sim fopen");
+            return 1;
+        }
+        fprintf(fp, "size,ways,line,sets,icache_hits,icache_misses,dcache_hits,dcache_misses\n");
+        for (const Config& c : configs) {
+            uint64_t ihits = igroups[c.group].hits(c.ways);
+            uint64_t dhits = dgroups[c.group].hits(c.ways);
+            fprintf(fp, "%u,%u,%u,%u,%llu,%llu,%llu,%llu\n", c.size, c.ways, c.line, c.sets,
+                    static_cast<unsigned long long>(ihits),
+                    static_cast<unsigned long long>(fetches - ihits),
+                    static_cast<unsigned long long>(dhits),
+                    static_cast<unsigned long long>(data - dhits));
+        }
+        if (fclose(fp) != 0) {
+            perror("cache_sim fclose");
+            return 1;
+        }
+        cout << "\nCSV saved to " << csv_path << endl;
+    }
+    return 0;
+}
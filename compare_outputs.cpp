@@ -0,0 +1,319 @@
+/**
+ * Compare RTL testbench output with golden model output: a streaming
+ * replacement for compare_outputs.py over the same text format,
+ *
+ *   === Cycle N ===            (N decimal, or hex if not all digits)
+ *   PC=0xXXXXXXXX              (or on the same line as the header)
+ *   x0=0x... x1=0x... ...      (any number of lines)
+ *
+ *   compare_outputs RTL_OUTPUT GOLDEN_OUTPUT [--max-mismatches N] [--verbose]
+ *
+ * Both files are mapped and scanned in place, one cycle block at a time,
+ * so memory use does not grow with the run. Cycles are expected in
+ * increasing order, as both writers print them; a cycle present in only
+ * one file counts as a mismatch. Values are compared as numbers, and a
+ * register a block does not list keeps its value from the file's
+ * previous block (0 at first), so full dumps compare exactly as in the
+ * Python script.
+ *
+ * Stops after N mismatches (default 10, 0 = never). --verbose also
+ * prints every matching cycle, as the Python script does. Exits 0 if
+ * everything matched, 1 otherwise, 2 if a file cannot be read.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// One "=== Cycle N ===" block
+struct CycleState {
+    uint64_t cycle;
+    uint32_t pc;
+    uint32_t regs[16];
+};
+
+// Read-only mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() : data(nullptr), size(0) {}
+    ~MappedFile() {
+        if (size) munmap(const_cast<char*>(data), size);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const char* path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            perror(path);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            perror("compare_outputs fstat");
+            close(fd);
+            return false;
+        }
+        size = static_cast<size_t>(st.st_size);
+        if (size == 0) {
+            data = "";
+            close(fd);
+            return true;
+        }
+        void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) {
+            perror("compare_outputs mmap");
+            size = 0;
+            return false;
+        }
+        madvise(map, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(map);
+        return true;
+    }
+
+    const char* data;
+    size_t size;
+};
+
+// Walks one output file block by block without copying it
+class CycleScanner {
+public:
+    CycleScanner(const char* begin, size_t size) : p(begin), end(begin + size) {
+        memset(&state, 0, sizeof(state));
+    }
+
+    // Next block with a PC, or nullptr at the end of the file. Registers
+    // not listed keep their previous values.
+    const CycleState* next() {
+        static const char HEADER[] = "=== Cycle ";
+        const size_t header_len = sizeof(HEADER) - 1;
+        for (;;) {
+            const char* hit = find(HEADER, header_len);
+            if (!hit) return nullptr;
+            p = hit + header_len;
+            if (parse_cycle() && parse_pc()) {
+                parse_registers();
+                return &state;
+            }
+        }
+    }
+
+    // A block's cycle number was not above the previous one's
+    bool out_of_order() const { return disorder; }
+
+private:
+    const char* p;
+    const char* end;
+    CycleState state;
+    bool started = false;
+    bool disorder = false;
+
+    const char* find(const char* needle, size_t n) {
+        const char* q = p;
+        while (static_cast<size_t>(end - q) >= n) {
+            const char* hit = static_cast<const char*>(memchr(q, needle[0], end - q - n + 1));
+            if (!hit) return nullptr;
+            if (memcmp(hit, needle, n) == 0) return hit;
+            q = hit + 1;
+        }
+        return nullptr;
+    }
+
+    static int hex_digit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    static bool is_word(char c) {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+               c == '_';
+    }
+
+    void skip_space() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    }
+
+    bool match(const char* s) {
+        size_t n = strlen(s);
+        if (static_cast<size_t>(end - p) < n || memcmp(p, s, n) != 0) return false;
+        p += n;
+        return true;
+    }
+
+    // "0x" then hex digits
+    bool parse_hex(uint32_t& v) {
+        if (!match("0x")) return false;
+        const char* start = p;
+        uint32_t x = 0;
+        int d;
+        while (p < end && (d = hex_digit(*p)) >= 0) {
+            x = (x << 4) | static_cast<uint32_t>(d);
+            p++;
+        }
+        v = x;
+        return p != start;
+    }
+
+    // "N ===": all digits is decimal, anything else hex
+    bool parse_cycle() {
+        const char* start = p;
+        bool decimal = true;
+        while (p < end && is_word(*p)) {
+            decimal = decimal && *p >= '0' && *p <= '9';
+            p++;
+        }
+        if (p == start) return false;
+        uint64_t n = 0;
+        for (const char* q = start; q < p; q++) {
+            int d = hex_digit(*q);
+            if (d < 0) return false;
+            n = decimal ? n * 10 + static_cast<uint64_t>(d) : (n << 4) | static_cast<uint64_t>(d);
+        }
+        skip_space();
+        if (!match("===")) return false;
+        if (started && n <= state.cycle) disorder = true;
+        started = true;
+        state.cycle = n;
+        return true;
+    }
+
+    bool parse_pc() {
+        skip_space();
+        return match("PC=") && parse_hex(state.pc);
+    }
+
+    // "xN=0x..." pairs, from the rest of the PC line on, up to the first
+    // line that has none; other lines between the PC and the first
+    // register line are skipped, like the Python script's patterns
+    void parse_registers() {
+        bool any = false;
+        while (p < end) {
+            const char* line = p;
+            skip_space();
+            if (p < end && *p == 'x') {
+                while (p < end && *p == 'x') {
+                    p++;
+                    uint32_t reg = 0;
+                    const char* digits = p;
+                    while (p < end && *p >= '0' && *p <= '9') reg = reg * 10 + (*p++ - '0');
+                    uint32_t value;
+                    if (p == digits || !match("=") || !parse_hex(value)) break;
+                    if (reg < 16) state.regs[reg] = value;
+                    any = true;
+                    while (p < end && (*p == ' ' || *p == '\t')) p++;
+                }
+                while (p < end && *p != '\n') p++;
+                continue;
+            }
+            if (any || (p < end && *p == '=')) {
+                p = line;
+                return;
+            }
+            while (p < end && *p != '\n') p++;
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    const char* paths[2] = {nullptr, nullptr};
+    int npaths = 0;
+    uint64_t max_mismatches = 10;
+    bool verbose = false;
+    bool usage = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--max-mismatches" && i + 1 < argc) {
+            max_mismatches = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--verbose") {
+            verbose = true;
+        } else if (npaths < 2 && arg[0] != '-') {
+            paths[npaths++] = argv[i];
+        } else {
+            usage = true;
+        }
+    }
+    if (usage || npaths != 2) {
+        fprintf(stderr,
+                "Usage: %s <rtl_output.txt> <golden_output.txt> [--max-mismatches N] "
+                "[--verbose]\n", argv[0]);
+        return 2;
+    }
+
+    MappedFile rtl_file, golden_file;
+    if (!rtl_file.open(paths[0]) || !golden_file.open(paths[1])) return 2;
+    CycleScanner rtl(rtl_file.data, rtl_file.size);
+    CycleScanner golden(golden_file.data, golden_file.size);
+
+    static char out_buf[1 << 16];
+    setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+    printf("================================================================================\n");
+    printf("RTL vs Golden Model Comparison\n");
+    printf("================================================================================\n");
+
+    uint64_t matches = 0;
+    uint64_t mismatches = 0;
+    const CycleState* r = rtl.next();
+    const CycleState* g = golden.next();
+    while ((r || g) && (max_mismatches == 0 || mismatches < max_mismatches)) {
+        // Merge on cycle number: a cycle in one file only is a mismatch
+        if (!g || (r && r->cycle < g->cycle)) {
+            printf("\n❌ Cycle %llu: Missing in Golden Model output\n",
+                   static_cast<unsigned long long>(r->cycle));
+            mismatches++;
+            r = rtl.next();
+            continue;
+        }
+        if (!r || g->cycle < r->cycle) {
+            printf("\n❌ Cycle %llu: Missing in RTL output\n",
+                   static_cast<unsigned long long>(g->cycle));
+            mismatches++;
+            g = golden.next();
+            continue;
+        }
+
+        bool pc_match = r->pc == g->pc;
+        bool regs_match = memcmp(r->regs, g->regs, sizeof(r->regs)) == 0;
+        if (pc_match && regs_match) {
+            matches++;
+            if (verbose) {
+                printf("✅ Cycle %llu: MATCH (PC=0x%08x)\n",
+                       static_cast<unsigned long long>(r->cycle), r->pc);
+            }
+        } else {
+            mismatches++;
+            printf("\n❌ Cycle %llu: MISMATCH\n", static_cast<unsigned long long>(r->cycle));
+            if (!pc_match) printf("   PC: RTL=0x%08x vs Golden=0x%08x\n", r->pc, g->pc);
+            for (int i = 0; i < 16; i++) {
+                if (r->regs[i] != g->regs[i]) {
+                    printf("   x%d: RTL=0x%08x vs Golden=0x%08x\n", i, r->regs[i], g->regs[i]);
+                }
+            }
+        }
+        r = rtl.next();
+        g = golden.next();
+    }
+    if (r || g) {
+        printf("\n⚠️  Stopping after %llu mismatches\n",
+               static_cast<unsigned long long>(mismatches));
+    }
+    bool ordered = !rtl.out_of_order() && !golden.out_of_order();
+    if (!ordered) {
+        printf("\n⚠️  %s has cycles out of order; results may be wrong\n",
+               rtl.out_of_order() ? paths[0] : paths[1]);
+    }
+
+    printf("\n================================================================================\n");
+    printf("Summary: %llu matches, %llu mismatches\n", static_cast<unsigned long long>(matches),
+           static_cast<unsigned long long>(mismatches));
+    printf("================================================================================\n");
+    return mismatches == 0 && ordered ? 0 : 1;
+}
@@ -2,6 +2,7 @@
 """
 Compare RTL testbench output with Golden Model output
 Extracts register states and compares cycle-by-cycle
+For long runs use compare_outputs.cpp, which streams both files
 """
 
 import re
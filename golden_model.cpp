@@ -1,18 +1,54 @@
 /**
  * Golden Model for RV32 Single-Cycle Processor
- * Supports: ADD, ADDI, LUI, LW, LBU, SW, SB, JALR
+ * Supports: RV32I (FENCE, ECALL and EBREAK execute as NOP)
  * 16 GPRs (x0-x15)
  */
 
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <iomanip>
+#include "tests/rv32_decoder.h"
+#include "tests/retire_trace.h"
+
+// Computed-goto dispatch needs the GCC/Clang labels-as-values extension
+#if defined(__GNUC__)
+#define GOLDEN_HAVE_THREADED 1
+#else
+#define GOLDEN_HAVE_THREADED 0
+#endif
+
+// The block JIT emits SysV x86-64 code into mmap'd pages
+#if defined(__x86_64__) && defined(__unix__)
+#define GOLDEN_HAVE_JIT 1
+#include <sys/mman.h>
+#else
+#define GOLDEN_HAVE_JIT 0
+#endif
 
 class RV32GoldenModel {
+public:
+    // Execution engines; both produce identical architectural state
+    enum Engine {
+        ENGINE_CALL,        // one handler call per instruction
+        ENGINE_THREADED,    // computed-goto threaded dispatch
+        ENGINE_JIT          // hot blocks compiled to x86-64, rest interpreted
+    };
+
 private:
+    // Pre-decoded instruction: the handler that executes it plus the
+    // operand fields it needs, so step() never re-decodes a word
+    struct DecodedInstr;
+    typedef uint32_t (*ExecFn)(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc);
+    struct DecodedInstr {
+        ExecFn exec;        // nullptr = slot not decoded yet
+        Rv32Op op;         // threaded engine's jump-table index
+        uint8_t rd, rs1, rs2;
+        int32_t imm;        // immediate in the op's format (see rv32_decoder.h)
+    };
+    
     // 16 General Purpose Registers
     uint32_t gpr[16];
     
@@ -25,25 +61,71 @@ private:
     // Data Memory (256 bytes)
     uint8_t dmem[256];
     
-    // Instruction fields
-    uint32_t opcode, rd, rs1, rs2, funct3, funct7;
-    int32_t imm_i;
-    uint32_t imm_u;
-    
-    // Decode instruction
-    void decode(uint32_t instr) {
-        opcode = instr & 0x7F;
-        rd = (instr >> 7) & 0x1F;
-        funct3 = (instr >> 12) & 0x07;
-        rs1 = (instr >> 15) & 0x1F;
-        rs2 = (instr >> 20) & 0x1F;
-        funct7 = (instr >> 25) & 0x7F;
-        
-        // I-type immediate (sign-extended)
-        imm_i = static_cast<int32_t>(instr) >> 20;
+    // Decoded copy of imem, filled on first fetch of each word.
+    // Stores only ever touch dmem, so entries go stale only when imem
+    // itself is reloaded.
+    DecodedInstr icache[256];
+    
+    Engine engine;
+    
+#if GOLDEN_HAVE_JIT
+    // Native code for hot basic blocks (straight-line runs ending at a
+    // jump or branch), keyed by the imem word the block starts at
+    typedef uint32_t (*JitFn)(uint32_t* regs, RV32GoldenModel* m, uint32_t pc);
+    struct JitBlock {
+        JitFn fn;           // nullptr = not compiled yet
+        uint32_t length;    // instructions retired per call
+        uint32_t hits;      // entries seen while still interpreted
+    };
+    static const uint32_t JIT_HOT_THRESHOLD = 16;
+    static const uint32_t JIT_MAX_BLOCK = 64;
+    static const size_t JIT_MAX_BLOCK_BYTES = 64 + JIT_MAX_BLOCK * 48;
+    static const size_t JIT_CODE_SIZE = 512 * 1024;
+    
+    JitBlock jit_blocks[256];
+    uint8_t* jit_code = nullptr;
+    size_t jit_used = 0;
+#endif
+    
+    void flush_icache() {
+        for (int i = 0; i < 256; i++) {
+            icache[i].exec = nullptr;
+        }
+#if GOLDEN_HAVE_JIT
+        jit_flush();
+#endif
+    }
+    
+    // Look up the decoded instruction at pc, decoding it on a miss
+    const DecodedInstr& fetch(uint32_t addr) {
+        DecodedInstr& d = icache[(addr >> 2) & 0xFF];
+        if (!d.exec) {
+            d = decode(imem[(addr >> 2) & 0xFF]);
+        }
+        return d;
+    }
+    
+    // Decode instruction into its handler and operands
+    static DecodedInstr decode(uint32_t instr) {
+        // Handler per decoder op, in Rv32Op order; unknown instructions
+        // are treated as NOP
+        static const ExecFn handlers[RV32_NUM_OPS] = {
+            exec_add, exec_addi, exec_lui, exec_lw, exec_lbu, exec_sw, exec_sb, exec_jalr,
+            exec_sub, exec_sll, exec_slt, exec_sltu, exec_xor, exec_srl, exec_sra, exec_or,
+            exec_and, exec_slti, exec_sltiu, exec_xori, exec_ori, exec_andi, exec_slli,
+            exec_srli, exec_srai, exec_auipc, exec_jal, exec_beq, exec_bne, exec_blt,
+            exec_bge, exec_bltu, exec_bgeu, exec_lb, exec_lh, exec_lhu, exec_sh, exec_nop
+        };
+        Rv32Decoded r = rv32_decode(instr);
         
-        // U-type immediate
-        imm_u = instr >> 12;
+        DecodedInstr d;
+        d.exec = handlers[r.op];
+        d.op = r.op;
+        d.rd = r.rd;
+        d.rs1 = r.rs1;
+        d.rs2 = r.rs2;
+        d.imm = r.imm;
+        return d;
     }
     
     // Write to register (x0 is hardwired to 0)
@@ -58,11 +140,16 @@ private:
         return gpr[index & 0xF];
     }
     
-    // Memory operations
+    // Memory operations (byte addresses wrap within the 256-byte dmem)
     uint32_t load_word(uint32_t addr) {
         addr &= 0xFF;  // 256 bytes memory
-        return (dmem[addr + 3] << 24) | (dmem[addr + 2] << 16) | 
-               (dmem[addr + 1] << 8) | dmem[addr];
+        return (dmem[(addr + 3) & 0xFF] << 24) | (dmem[(addr + 2) & 0xFF] << 16) | 
+               (dmem[(addr + 1) & 0xFF] << 8) | dmem[addr];
+    }
+    
+    uint32_t load_half_unsigned(uint32_t addr) {
+        addr &= 0xFF;
+        return (dmem[(addr + 1) & 0xFF] << 8) | dmem[addr];
     }
     
     uint32_t load_byte_unsigned(uint32_t addr) {
@@ -73,21 +160,484 @@ private:
     void store_word(uint32_t addr, uint32_t value) {
         addr &= 0xFF;
         dmem[addr] = value & 0xFF;
-        dmem[addr + 1] = (value >> 8) & 0xFF;
-        dmem[addr + 2] = (value >> 16) & 0xFF;
-        dmem[addr + 3] = (value >> 24) & 0xFF;
+        dmem[(addr + 1) & 0xFF] = (value >> 8) & 0xFF;
+        dmem[(addr + 2) & 0xFF] = (value >> 16) & 0xFF;
+        dmem[(addr + 3) & 0xFF] = (value >> 24) & 0xFF;
+    }
+    
+    void store_half(uint32_t addr, uint32_t value) {
+        addr &= 0xFF;
+        dmem[addr] = value & 0xFF;
+        dmem[(addr + 1) & 0xFF] = (value >> 8) & 0xFF;
     }
     
     void store_byte(uint32_t addr, uint32_t value) {
         addr &= 0xFF;
         dmem[addr] = value & 0xFF;
     }
+    
+    // Instruction handlers: execute one decoded instruction, return next PC
+    static uint32_t exec_nop(RV32GoldenModel&, const DecodedInstr&, uint32_t pc) {
+        return pc + 4;
+    }
+    
+    static uint32_t exec_add(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) + m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_sub(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) - m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_sll(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) << (m.read_gpr(d.rs2) & 0x1F));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_slt(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, static_cast<int32_t>(m.read_gpr(d.rs1)) <
+                          static_cast<int32_t>(m.read_gpr(d.rs2)));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_sltu(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) < m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_xor(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) ^ m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_srl(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) >> (m.read_gpr(d.rs2) & 0x1F));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_sra(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, static_cast<int32_t>(m.read_gpr(d.rs1)) >> (m.read_gpr(d.rs2) & 0x1F));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_or(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) | m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_and(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) & m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_addi(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) + d.imm);
+        return pc + 4;
+    }
+    
+    static uint32_t exec_slti(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, static_cast<int32_t>(m.read_gpr(d.rs1)) < d.imm);
+        return pc + 4;
+    }
+    
+    static uint32_t exec_sltiu(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) < static_cast<uint32_t>(d.imm));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_xori(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) ^ d.imm);
+        return pc + 4;
+    }
+    
+    static uint32_t exec_ori(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) | d.imm);
+        return pc + 4;
+    }
+    
+    static uint32_t exec_andi(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) & d.imm);
+        return pc + 4;
+    }
+    
+    static uint32_t exec_slli(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) << d.imm);
+        return pc + 4;
+    }
+    
+    static uint32_t exec_srli(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) >> d.imm);
+        return pc + 4;
+    }
+    
+    static uint32_t exec_srai(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, static_cast<int32_t>(m.read_gpr(d.rs1)) >> d.imm);
+        return pc + 4;
+    }
+    
+    static uint32_t exec_lui(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, d.imm);
+        return pc + 4;
+    }
+    
+    static uint32_t exec_auipc(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, pc + d.imm);
+        return pc + 4;
+    }
+    
+    static uint32_t exec_lw(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.load_word(m.read_gpr(d.rs1) + d.imm));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_lh(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, static_cast<int16_t>(m.load_half_unsigned(m.read_gpr(d.rs1) + d.imm)));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_lhu(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.load_half_unsigned(m.read_gpr(d.rs1) + d.imm));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_lb(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, static_cast<int8_t>(m.load_byte_unsigned(m.read_gpr(d.rs1) + d.imm)));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_lbu(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.load_byte_unsigned(m.read_gpr(d.rs1) + d.imm));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_sw(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.store_word(m.read_gpr(d.rs1) + d.imm, m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_sh(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.store_half(m.read_gpr(d.rs1) + d.imm, m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_sb(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.store_byte(m.read_gpr(d.rs1) + d.imm, m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    
+    static uint32_t exec_jal(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, pc + 4);
+        return pc + d.imm;
+    }
+    
+    static uint32_t exec_jalr(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        uint32_t target = (m.read_gpr(d.rs1) + d.imm) & ~1u; // Clear LSB
+        m.write_gpr(d.rd, pc + 4);
+        return target;
+    }
+    
+    static uint32_t exec_beq(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        return m.read_gpr(d.rs1) == m.read_gpr(d.rs2) ? pc + d.imm : pc + 4;
+    }
+    
+    static uint32_t exec_bne(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        return m.read_gpr(d.rs1) != m.read_gpr(d.rs2) ? pc + d.imm : pc + 4;
+    }
+    
+    static uint32_t exec_blt(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        return static_cast<int32_t>(m.read_gpr(d.rs1)) < static_cast<int32_t>(m.read_gpr(d.rs2))
+               ? pc + d.imm : pc + 4;
+    }
+    
+    static uint32_t exec_bge(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        return static_cast<int32_t>(m.read_gpr(d.rs1)) >= static_cast<int32_t>(m.read_gpr(d.rs2))
+               ? pc + d.imm : pc + 4;
+    }
+    
+    static uint32_t exec_bltu(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        return m.read_gpr(d.rs1) < m.read_gpr(d.rs2) ? pc + d.imm : pc + 4;
+    }
+    
+    static uint32_t exec_bgeu(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        return m.read_gpr(d.rs1) >= m.read_gpr(d.rs2) ? pc + d.imm : pc + 4;
+    }
+    
+#if GOLDEN_HAVE_JIT
+    // Memory accesses from JIT code go through these, so they keep the
+    // interpreter's wrap-around semantics
+    static uint32_t jit_load_word(RV32GoldenModel* m, uint32_t addr) {
+        return m->load_word(addr);
+    }
+    static uint32_t jit_load_byte_unsigned(RV32GoldenModel* m, uint32_t addr) {
+        return m->load_byte_unsigned(addr);
+    }
+    static void jit_store_word(RV32GoldenModel* m, uint32_t addr, uint32_t value) {
+        m->store_word(addr, value);
+    }
+    static void jit_store_byte(RV32GoldenModel* m, uint32_t addr, uint32_t value) {
+        m->store_byte(addr, value);
+    }
+    
+    // Drop every compiled block. imem is only written by load_imem() and
+    // reset(); SW/SB go to the separate dmem and never hit code.
+    void jit_flush() {
+        for (int i = 0; i < 256; i++) {
+            jit_blocks[i].fn = nullptr;
+            jit_blocks[i].hits = 0;
+        }
+        jit_used = 0;
+    }
+    
+    void jit_emit8(uint8_t b) {
+        jit_code[jit_used++] = b;
+    }
+    
+    void jit_emit32(uint32_t v) {
+        memcpy(jit_code + jit_used, &v, 4);
+        jit_used += 4;
+    }
+    
+    void jit_emit64(uint64_t v) {
+        memcpy(jit_code + jit_used, &v, 8);
+        jit_used += 8;
+    }
+    
+    // disp8 of gpr[index] from rbx
+    static uint8_t jit_gpr_disp(uint32_t index) {
+        return static_cast<uint8_t>((index & 0xF) * 4);
+    }
+    
+    // mov r32, [rbx + gpr]; reg is the 3-bit register number
+    void jit_load_gpr(uint8_t reg, uint32_t index) {
+        jit_emit8(0x8B); jit_emit8(0x43 | (reg << 3)); jit_emit8(jit_gpr_disp(index));
+    }
+    
+    // mov [rbx + gpr], r32 (skipped for x0, like write_gpr)
+    void jit_store_gpr(uint8_t reg, uint32_t index) {
+        if ((index & 0xF) == 0) return;
+        jit_emit8(0x89); jit_emit8(0x43 | (reg << 3)); jit_emit8(jit_gpr_disp(index));
+    }
+    
+    // add r32, imm32
+    void jit_add_imm(uint8_t reg, int32_t imm) {
+        if (imm == 0) return;
+        jit_emit8(0x81); jit_emit8(0xC0 | reg); jit_emit32(static_cast<uint32_t>(imm));
+    }
+    
+    // and/or/xor r32, imm32; ext is the ModRM /digit
+    void jit_alu_imm(uint8_t ext, uint8_t reg, int32_t imm) {
+        jit_emit8(0x81); jit_emit8(0xC0 | (ext << 3) | reg); jit_emit32(static_cast<uint32_t>(imm));
+    }
+    
+    // eax = gpr[rs1] op gpr[rs2] for an x86 "op r32, r/m32" opcode
+    void jit_alu_reg(uint8_t opcode, const DecodedInstr& d) {
+        jit_load_gpr(0, d.rs1);                                     // mov eax, [rs1]
+        jit_emit8(opcode); jit_emit8(0x43); jit_emit8(jit_gpr_disp(d.rs2)); // op eax, [rs2]
+        jit_store_gpr(0, d.rd);
+    }
+    
+    // shl/shr/sar eax by the immediate shift amount; ext is the ModRM /digit
+    void jit_shift_imm(uint8_t ext, const DecodedInstr& d) {
+        jit_load_gpr(0, d.rs1);
+        jit_emit8(0xC1); jit_emit8(0xC0 | (ext << 3)); jit_emit8(static_cast<uint8_t>(d.imm));
+        jit_store_gpr(0, d.rd);
+    }
+    
+    // Ops without native code call their interpreter handler:
+    // eax = d.exec(*m, d, pc), with pc = entry PC + offset
+    static uint32_t jit_exec(RV32GoldenModel* m, const DecodedInstr* d, uint32_t pc) {
+        return d->exec(*m, *d, pc);
+    }
+    
+    void jit_call_exec(const DecodedInstr& d, uint32_t offset) {
+        jit_emit8(0x4C); jit_emit8(0x89); jit_emit8(0xE7);         // mov rdi, r12
+        jit_emit8(0x48); jit_emit8(0xBE);                           // mov rsi, &d
+        jit_emit64(reinterpret_cast<uint64_t>(&d));
+        jit_emit8(0x44); jit_emit8(0x89); jit_emit8(0xEA);          // mov edx, r13d
+        jit_add_imm(2, static_cast<int32_t>(offset));               // add edx, offset
+        jit_emit8(0x48); jit_emit8(0xB8);                           // mov rax, jit_exec
+        jit_emit64(reinterpret_cast<uint64_t>(&jit_exec));
+        jit_emit8(0xFF); jit_emit8(0xD0);                           // call rax
+    }
+    
+    // rdi = m, esi = gpr[rs1] + imm, then call helper
+    void jit_call_mem(const DecodedInstr& d, const void* helper, bool pass_rs2) {
+        jit_emit8(0x4C); jit_emit8(0x89); jit_emit8(0xE7);         // mov rdi, r12
+        jit_load_gpr(6, d.rs1);                                     // mov esi, [rs1]
+        jit_add_imm(6, d.imm);                                      // add esi, imm
+        if (pass_rs2) jit_load_gpr(2, d.rs2);                       // mov edx, [rs2]
+        jit_emit8(0x48); jit_emit8(0xB8);                           // mov rax, helper
+        jit_emit64(reinterpret_cast<uint64_t>(helper));
+        jit_emit8(0xFF); jit_emit8(0xD0);                           // call rax
+    }
+    
+    void jit_emit_epilogue() {
+        jit_emit8(0x41); jit_emit8(0x5D);                           // pop r13
+        jit_emit8(0x41); jit_emit8(0x5C);                           // pop r12
+        jit_emit8(0x5B);                                            // pop rbx
+        jit_emit8(0xC3);                                            // ret
+    }
+    
+    // Compile the block starting at imem word idx. Generated code keeps
+    // rbx = gpr, r12 = model, r13d = entry PC and returns the next PC.
+    bool jit_compile(uint32_t idx) {
+        if (!jit_code) {
+            void* mem = mmap(nullptr, JIT_CODE_SIZE, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mem == MAP_FAILED) {
+                std::cerr << "Warning: JIT code buffer unavailable, interpreting" << std::endl;
+                set_engine(ENGINE_THREADED);
+                return false;
+            }
+            jit_code = static_cast<uint8_t*>(mem);
+        }
+        if (jit_used + JIT_MAX_BLOCK_BYTES > JIT_CODE_SIZE) {
+            jit_flush();
+        }
+        mprotect(jit_code, JIT_CODE_SIZE, PROT_READ | PROT_WRITE);
+        
+        size_t start = jit_used;
+        jit_emit8(0x53);                                            // push rbx
+        jit_emit8(0x41); jit_emit8(0x54);                           // push r12
+        jit_emit8(0x41); jit_emit8(0x55);                           // push r13
+        jit_emit8(0x48); jit_emit8(0x89); jit_emit8(0xFB);          // mov rbx, rdi
+        jit_emit8(0x49); jit_emit8(0x89); jit_emit8(0xF4);          // mov r12, rsi
+        jit_emit8(0x41); jit_emit8(0x89); jit_emit8(0xD5);          // mov r13d, edx
+        
+        uint32_t len = 0;
+        bool ended = false;
+        while (len < JIT_MAX_BLOCK && !ended) {
+            const DecodedInstr& d = fetch(((idx + len) & 0xFF) << 2);
+            switch (d.op) {
+                case RV32_ADD:
+                    jit_load_gpr(0, d.rs1);                         // mov eax, [rs1]
+                    jit_emit8(0x03); jit_emit8(0x43);               // add eax, [rs2]
+                    jit_emit8(jit_gpr_disp(d.rs2));
+                    jit_store_gpr(0, d.rd);
+                    break;
+                case RV32_ADDI:
+                    jit_load_gpr(0, d.rs1);
+                    jit_add_imm(0, d.imm);
+                    jit_store_gpr(0, d.rd);
+                    break;
+                case RV32_LUI:
+                    if ((d.rd & 0xF) != 0) {
+                        jit_emit8(0xC7); jit_emit8(0x43);           // mov dword [rd], imm
+                        jit_emit8(jit_gpr_disp(d.rd));
+                        jit_emit32(static_cast<uint32_t>(d.imm));
+                    }
+                    break;
+                case RV32_LW:
+                    jit_call_mem(d, reinterpret_cast<const void*>(&jit_load_word), false);
+                    jit_store_gpr(0, d.rd);
+                    break;
+                case RV32_LBU:
+                    jit_call_mem(d, reinterpret_cast<const void*>(&jit_load_byte_unsigned), false);
+                    jit_store_gpr(0, d.rd);
+                    break;
+                case RV32_SW:
+                    jit_call_mem(d, reinterpret_cast<const void*>(&jit_store_word), true);
+                    break;
+                case RV32_SB:
+                    jit_call_mem(d, reinterpret_cast<const void*>(&jit_store_byte), true);
+                    break;
+                case RV32_JALR:
+                    // Target from rs1 before the link write, as rd may equal rs1
+                    jit_load_gpr(0, d.rs1);
+                    jit_add_imm(0, d.imm);
+                    jit_emit8(0x83); jit_emit8(0xE0); jit_emit8(0xFE); // and eax, ~1
+                    if ((d.rd & 0xF) != 0) {
+                        jit_emit8(0x44); jit_emit8(0x89); jit_emit8(0xE9); // mov ecx, r13d
+                        jit_add_imm(1, static_cast<int32_t>(len * 4 + 4));
+                        jit_store_gpr(1, d.rd);
+                    }
+                    jit_emit_epilogue();
+                    ended = true;
+                    break;
+                case RV32_SUB:
+                    jit_alu_reg(0x2B, d);
+                    break;
+                case RV32_XOR:
+                    jit_alu_reg(0x33, d);
+                    break;
+                case RV32_OR:
+                    jit_alu_reg(0x0B, d);
+                    break;
+                case RV32_AND:
+                    jit_alu_reg(0x23, d);
+                    break;
+                case RV32_XORI:
+                    jit_load_gpr(0, d.rs1);
+                    jit_alu_imm(6, 0, d.imm);
+                    jit_store_gpr(0, d.rd);
+                    break;
+                case RV32_ORI:
+                    jit_load_gpr(0, d.rs1);
+                    jit_alu_imm(1, 0, d.imm);
+                    jit_store_gpr(0, d.rd);
+                    break;
+                case RV32_ANDI:
+                    jit_load_gpr(0, d.rs1);
+                    jit_alu_imm(4, 0, d.imm);
+                    jit_store_gpr(0, d.rd);
+                    break;
+                case RV32_SLLI:
+                    jit_shift_imm(4, d);
+                    break;
+                case RV32_SRLI:
+                    jit_shift_imm(5, d);
+                    break;
+                case RV32_SRAI:
+                    jit_shift_imm(7, d);
+                    break;
+                case RV32_AUIPC:
+                    jit_emit8(0x44); jit_emit8(0x89); jit_emit8(0xE8); // mov eax, r13d
+                    jit_add_imm(0, static_cast<int32_t>(len * 4 + static_cast<uint32_t>(d.imm)));
+                    jit_store_gpr(0, d.rd);
+                    break;
+                case RV32_OTHER:
+                    break;
+                default:
+                    // Branches and JAL return the next PC: the block ends there
+                    jit_call_exec(d, len * 4);
+                    if (rv32_is_jump(d.op)) {
+                        jit_emit_epilogue();
+                        ended = true;
+                    }
+                    break;
+            }
+            len++;
+        }
+        if (!ended) {
+            jit_emit8(0x44); jit_emit8(0x89); jit_emit8(0xE8);      // mov eax, r13d
+            jit_add_imm(0, static_cast<int32_t>(len * 4));
+            jit_emit_epilogue();
+        }
+        
+        mprotect(jit_code, JIT_CODE_SIZE, PROT_READ | PROT_EXEC);
+        jit_blocks[idx].fn = reinterpret_cast<JitFn>(jit_code + start);
+        jit_blocks[idx].length = len;
+        return true;
+    }
+#endif
 
 public:
-    RV32GoldenModel() {
+    RV32GoldenModel() : engine(GOLDEN_HAVE_THREADED ? ENGINE_THREADED : ENGINE_CALL) {
         reset();
     }
     
+    ~RV32GoldenModel() {
+#if GOLDEN_HAVE_JIT
+        if (jit_code) munmap(jit_code, JIT_CODE_SIZE);
+#endif
+    }
+    
+    // Owns the JIT code buffer
+    RV32GoldenModel(const RV32GoldenModel&) = delete;
+    RV32GoldenModel& operator=(const RV32GoldenModel&) = delete;
+    
     void reset() {
         // Clear all registers
         memset(gpr, 0, sizeof(gpr));
@@ -96,6 +646,7 @@ public:
         // Clear memories
         memset(imem, 0, sizeof(imem));
         memset(dmem, 0, sizeof(dmem));
+        flush_icache();
     }
     
     // Load instruction memory from hex file
@@ -118,6 +669,7 @@ public:
         
         std::cout << "Loaded " << addr << " instructions from " << filename << std::endl;
         file.close();
+        flush_icache();
         return true;
     }
     
@@ -146,84 +698,176 @@ public:
     
     // Execute one instruction
     void step() {
-        // Fetch
-        uint32_t instr = imem[(pc >> 2) & 0xFF];
-        uint32_t current_pc = pc;
+        const DecodedInstr& d = fetch(pc);
+        pc = d.exec(*this, d, pc);
+    }
+    
+    // Execute one instruction on the call engine and report what it
+    // changed. Stores are given in the RTL's lanes (see retire_trace.h),
+    // even though dmem itself takes unaligned words byte by byte.
+    RetireTraceRecord step_record() {
+        const DecodedInstr& d = fetch(pc);
+        RetireTraceRecord r = {};
+        if (d.op == RV32_SW || d.op == RV32_SH || d.op == RV32_SB) {
+            uint32_t addr = read_gpr(d.rs1) + d.imm;
+            uint32_t value = read_gpr(d.rs2);
+            r.mem_we = true;
+            r.mem_addr = addr & ~0x3u;
+            if (d.op == RV32_SW) {
+                r.mem_mask = 0xF;
+                r.mem_data = value;
+            } else if (d.op == RV32_SH) {
+                r.mem_mask = 0x3 << (addr & 0x2);
+                r.mem_data = value << ((addr & 0x2) * 8);
+            } else {
+                r.mem_mask = 1u << (addr & 0x3);
+                r.mem_data = value << ((addr & 0x3) * 8);
+            }
+        }
+        pc = d.exec(*this, d, pc);
+        if (rv32_writes_rd(d.op) && (d.rd & 0xF) != 0) {
+            r.we = true;
+            r.rd = d.rd & 0xF;
+            r.wdata = gpr[r.rd];
+        }
+        r.next_pc = pc;
+        return r;
+    }
+    
+    // Execute n instructions with the selected engine
+    void run(uint64_t n) {
+        if (engine == ENGINE_JIT) {
+            run_jit(n);
+        } else if (engine == ENGINE_THREADED) {
+            run_threaded(n);
+        } else {
+            while (n--) step();
+        }
+    }
+    
+    // Threaded engine: every handler ends in its own indirect jump to
+    // the next one, so the host predictor sees one branch per handler
+    // instead of a single shared switch
+    void run_threaded(uint64_t n) {
+#if GOLDEN_HAVE_THREADED
+        static void* const dispatch_table[] = {
+            &&op_add, &&op_addi, &&op_lui, &&op_lw, &&op_lbu, &&op_sw, &&op_sb, &&op_jalr,
+            &&op_sub, &&op_sll, &&op_slt, &&op_sltu, &&op_xor, &&op_srl, &&op_sra, &&op_or,
+            &&op_and, &&op_slti, &&op_sltiu, &&op_xori, &&op_ori, &&op_andi, &&op_slli,
+            &&op_srli, &&op_srai, &&op_auipc, &&op_jal, &&op_beq, &&op_bne, &&op_blt,
+            &&op_bge, &&op_bltu, &&op_bgeu, &&op_lb, &&op_lh, &&op_lhu, &&op_sh, &&op_nop
+        };
+        static_assert(sizeof(dispatch_table) / sizeof(dispatch_table[0]) == RV32_NUM_OPS,
+                      "one label per Rv32Op");
+        uint32_t cur_pc = pc;
+        const DecodedInstr* d;
         
-        // Decode
-        decode(instr);
+#define DISPATCH()                              \
+        do {                                    \
+            if (n-- == 0) goto done;            \
+            d = &fetch(cur_pc);                 \
+            goto *dispatch_table[d->op];        \
+        } while (0)
         
-        // Execute
-        uint32_t next_pc = pc + 4;
-        uint32_t alu_result = 0;
-        bool branch_taken = false;
+        DISPATCH();
         
-        switch (opcode) {
-            case 0b0110011: // R-type: ADD
-                if (funct7 == 0x00 && funct3 == 0x0) {
-                    alu_result = read_gpr(rs1) + read_gpr(rs2);
-                    write_gpr(rd, alu_result);
-                }
-                break;
-                
-            case 0b0010011: // I-type: ADDI
-                if (funct3 == 0x0) {
-                    alu_result = read_gpr(rs1) + imm_i;
-                    write_gpr(rd, alu_result);
-                }
-                break;
-                
-            case 0b0110111: // U-type: LUI
-                alu_result = imm_u << 12;
-                write_gpr(rd, alu_result);
-                break;
-                
-            case 0b0000011: // I-type: Load
-                alu_result = read_gpr(rs1) + imm_i;
-                if (funct3 == 0b010) { // LW
-                    write_gpr(rd, load_word(alu_result));
-                } else if (funct3 == 0b100) { // LBU
-                    write_gpr(rd, load_byte_unsigned(alu_result));
-                }
-                break;
-                
-            case 0b0100011: // S-type: Store
-                alu_result = read_gpr(rs1) + imm_i;
-                if (funct3 == 0b010) { // SW
-                    store_word(alu_result, read_gpr(rs2));
-                } else if (funct3 == 0b000) { // SB
-                    store_byte(alu_result, read_gpr(rs2));
-                }
-                break;
-                
-            case 0b1100111: // I-type: JALR
-                if (funct3 == 0x0) {
-                    alu_result = (read_gpr(rs1) + imm_i) & ~1; // Clear LSB
-                    write_gpr(rd, current_pc + 4);
-                    next_pc = alu_result;
-                    branch_taken = true;
-                }
-                break;
-                
-            default:
-                // Unknown instruction - treat as NOP
-                break;
-        }
+    op_nop:
+        cur_pc += 4;
+        DISPATCH();
+    op_add:
+        write_gpr(d->rd, read_gpr(d->rs1) + read_gpr(d->rs2));
+        cur_pc += 4;
+        DISPATCH();
+    op_addi:
+        write_gpr(d->rd, read_gpr(d->rs1) + d->imm);
+        cur_pc += 4;
+        DISPATCH();
+    op_lui:
+        write_gpr(d->rd, d->imm);
+        cur_pc += 4;
+        DISPATCH();
+    op_lw:
+        write_gpr(d->rd, load_word(read_gpr(d->rs1) + d->imm));
+        cur_pc += 4;
+        DISPATCH();
+    op_lbu:
+        write_gpr(d->rd, load_byte_unsigned(read_gpr(d->rs1) + d->imm));
+        cur_pc += 4;
+        DISPATCH();
+    op_sw:
+        store_word(read_gpr(d->rs1) + d->imm, read_gpr(d->rs2));
+        cur_pc += 4;
+        DISPATCH();
+    op_sb:
+        store_byte(read_gpr(d->rs1) + d->imm, read_gpr(d->rs2));
+        cur_pc += 4;
+        DISPATCH();
+    op_jalr: {
+        uint32_t target = (read_gpr(d->rs1) + d->imm) & ~1u;
+        write_gpr(d->rd, cur_pc + 4);
+        cur_pc = target;
+        DISPATCH();
+    }
+    
+        // The rest run their call-engine handler, inlined here
+#define HANDLER(label, exec)                    \
+    label:                                      \
+        cur_pc = exec(*this, *d, cur_pc);       \
+        DISPATCH();
+        
+        HANDLER(op_sub, exec_sub) HANDLER(op_sll, exec_sll) HANDLER(op_slt, exec_slt)
+        HANDLER(op_sltu, exec_sltu) HANDLER(op_xor, exec_xor) HANDLER(op_srl, exec_srl)
+        HANDLER(op_sra, exec_sra) HANDLER(op_or, exec_or) HANDLER(op_and, exec_and)
+        HANDLER(op_slti, exec_slti) HANDLER(op_sltiu, exec_sltiu) HANDLER(op_xori, exec_xori)
+        HANDLER(op_ori, exec_ori) HANDLER(op_andi, exec_andi) HANDLER(op_slli, exec_slli)
+        HANDLER(op_srli, exec_srli) HANDLER(op_srai, exec_srai) HANDLER(op_auipc, exec_auipc)
+        HANDLER(op_jal, exec_jal) HANDLER(op_beq, exec_beq) HANDLER(op_bne, exec_bne)
+        HANDLER(op_blt, exec_blt) HANDLER(op_bge, exec_bge) HANDLER(op_bltu, exec_bltu)
+        HANDLER(op_bgeu, exec_bgeu) HANDLER(op_lb, exec_lb) HANDLER(op_lh, exec_lh)
+        HANDLER(op_lhu, exec_lhu) HANDLER(op_sh, exec_sh)
         
-        // Update PC
-        pc = next_pc;
+#undef HANDLER
+#undef DISPATCH
+    done:
+        pc = cur_pc;
+#else
+        while (n--) step();
+#endif
     }
     
-    // Print register state
-    void print_state() {
-        std::cout << "PC=0x" << std::hex << std::setw(8) << std::setfill('0') << pc << std::endl;
-        for (int i = 0; i < 16; i++) {
-            std::cout << "x" << std::dec << i << "=0x" << std::hex 
-                      << std::setw(8) << std::setfill('0') << gpr[i];
-            if (i % 4 == 3) std::cout << std::endl;
-            else std::cout << " ";
+    // JIT engine: a block is compiled once it has been entered
+    // JIT_HOT_THRESHOLD times. Cold code, and blocks longer than the
+    // remaining budget, run on the interpreter; so does everything once
+    // the engine has fallen back to threaded.
+    void run_jit(uint64_t n) {
+#if GOLDEN_HAVE_JIT
+        while (n > 0 && engine == ENGINE_JIT) {
+            JitBlock& b = jit_blocks[(pc >> 2) & 0xFF];
+            if (!b.fn && ++b.hits >= JIT_HOT_THRESHOLD) {
+                jit_compile((pc >> 2) & 0xFF);
+            }
+            if (b.fn && b.length <= n) {
+                pc = b.fn(gpr, this, pc);
+                n -= b.length;
+            } else {
+                step();
+                n--;
+            }
         }
-        std::cout << std::dec;
+#endif
+        run_threaded(n);
+    }
+    
+    // An engine this build lacks falls back to the next simpler one
+    // (JIT to threaded to call), and get_engine() reports what really runs
+    void set_engine(Engine e) {
+        if (e == ENGINE_JIT && !GOLDEN_HAVE_JIT) e = ENGINE_THREADED;
+        if (e == ENGINE_THREADED && !GOLDEN_HAVE_THREADED) e = ENGINE_CALL;
+        engine = e;
+    }
+    
+    Engine get_engine() const {
+        return engine;
     }
     
     // Get register value
@@ -242,18 +886,159 @@ public:
     }
 };
 
+// Register dumps in the "=== Cycle N ===" text format compare_outputs
+// reads. Blocks are formatted by hand into a 1 MiB buffer and written
+// with fwrite, so stdout is not flushed per line. Other output must
+// call flush() first to keep its place.
+class StateDump {
+public:
+    explicit StateDump(FILE* out) : out(out), len(0), buf(BUF_SIZE), have_prev(false) {}
+    ~StateDump() { flush(); }
+    StateDump(const StateDump&) = delete;
+    StateDump& operator=(const StateDump&) = delete;
+
+    // One block. With diff_only, only the registers that changed since
+    // the previous block are listed (the first block lists all of them).
+    void write(uint64_t cycle, uint32_t pc, const uint32_t* gpr, bool diff_only) {
+        if (len > BUF_SIZE - MAX_BLOCK) flush();
+        char* p = &buf[len];
+        p = put_str(p, "\n=== Cycle ");
+        p = put_dec(p, cycle);
+        p = put_str(p, " ===\nPC=0x");
+        p = put_hex(p, pc);
+        *p++ = '\n';
+        int listed = 0;
+        for (int i = 0; i < 16; i++) {
+            if (diff_only && have_prev && gpr[i] == prev[i]) continue;
+            *p++ = 'x';
+            p = put_dec(p, static_cast<uint64_t>(i));
+            p = put_str(p, "=0x");
+            p = put_hex(p, gpr[i]);
+            *p++ = ++listed % 4 == 0 ? '\n' : ' ';
+        }
+        if (listed % 4) p[-1] = '\n';
+        memcpy(prev, gpr, sizeof(prev));
+        have_prev = true;
+        len = static_cast<size_t>(p - buf.data());
+    }
+
+    void flush() {
+        if (len) std::fwrite(buf.data(), 1, len, out);
+        len = 0;
+        std::fflush(out);
+    }
+
+private:
+    static const size_t BUF_SIZE = 1 << 20;
+    static const size_t MAX_BLOCK = 512;    // a full block is about 260 bytes
+
+    FILE* out;
+    size_t len;
+    std::vector<char> buf;
+    uint32_t prev[16];
+    bool have_prev;
+
+    static char* put_str(char* p, const char* s) {
+        while (*s) *p++ = *s++;
+        return p;
+    }
+
+    static char* put_dec(char* p, uint64_t v) {
+        char tmp[20];
+        int n = 0;
+        do {
+            tmp[n++] = static_cast<char>('0' + v % 10);
+            v /= 10;
+        } while (v);
+        while (n) *p++ = tmp[--n];
+        return p;
+    }
+
+    // Eight lower-case digits
+    static char* put_hex(char* p, uint32_t v) {
+        static const char digits[] = "0123456789abcdef";
+        for (int shift = 28; shift >= 0; shift -= 4) {
+            *p++ = digits[(v >> shift) & 0xF];
+        }
+        return p;
+    }
+};
+
 // Main test program
 int main(int argc, char** argv) {
     RV32GoldenModel model;
     
     std::string imem_file = "imem.hex";
     std::string dmem_file = "dmem.hex";
-    int num_cycles = 20;
+    uint64_t num_cycles = 20;
+    std::string retire_trace_path;
+    // When to print the state: every dump_every cycles (1 = each cycle),
+    // only when a register changed, or only at the end
+    enum DumpMode { DUMP_EVERY, DUMP_CHANGE, DUMP_FINAL };
+    DumpMode dump_mode = DUMP_EVERY;
+    uint64_t dump_every = 1;
+    bool diff_only = false;
     
-    // Parse command line arguments
-    if (argc > 1) imem_file = argv[1];
-    if (argc > 2) dmem_file = argv[2];
-    if (argc > 3) num_cycles = std::stoi(argv[3]);
+    // Parse command line arguments:
+    //   golden_model [imem] [dmem] [cycles] [--engine=call|threaded|jit]
+    //                [--dump=cycle|change|final] [--dump-every=N]
+    //                [--diff-only] [--retire-trace=PATH]
+    // --dump picks which cycles print their state: every one (default),
+    // those that changed a register (stepping on the call engine), or
+    // only the last. --dump-every=N prints every Nth cycle and the
+    // last. Batches between dumps run on the selected engine in one go.
+    // --diff-only lists only the registers changed since the previous
+    // dump; compare_outputs carries the others over.
+    // --retire-trace writes every retirement to PATH in the binary format
+    // of tests/retire_trace.h (for trace_diff) instead of printing the
+    // state each cycle; it steps on the call engine.
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--engine=call") {
+            model.set_engine(RV32GoldenModel::ENGINE_CALL);
+        } else if (arg == "--engine=threaded") {
+            model.set_engine(RV32GoldenModel::ENGINE_THREADED);
+        } else if (arg == "--engine=jit") {
+            model.set_engine(RV32GoldenModel::ENGINE_JIT);
+        } else if (arg == "--dump=cycle") {
+            dump_mode = DUMP_EVERY;
+            dump_every = 1;
+        } else if (arg == "--dump=change") {
+            dump_mode = DUMP_CHANGE;
+        } else if (arg == "--dump=final") {
+            dump_mode = DUMP_FINAL;
+        } else if (arg.compare(0, 13, "--dump-every=") == 0) {
+            dump_mode = DUMP_EVERY;
+            dump_every = std::stoull(arg.substr(13));
+            if (dump_every == 0) {
+                std::cerr << "Error: --dump-every needs N > 0" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--diff-only") {
+            diff_only = true;
+        } else if (arg.compare(0, 15, "--retire-trace=") == 0) {
+            retire_trace_path = arg.substr(15);
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            return 1;
+        } else {
+            args.push_back(arg);
+        }
+    }
+    // The JIT only enters a compiled block when the whole block fits in
+    // the batch, so stepping one instruction at a time would interpret
+    // everything, slower than the threaded engine
+    bool per_instruction = !retire_trace_path.empty() || dump_mode == DUMP_CHANGE ||
+                           (dump_mode == DUMP_EVERY && dump_every == 1);
+    if (per_instruction && model.get_engine() == RV32GoldenModel::ENGINE_JIT) {
+        std::cerr << "Warning: --engine=jit needs --dump=final or --dump-every=N to run "
+                  << "compiled blocks; using the threaded engine" << std::endl;
+        model.set_engine(RV32GoldenModel::ENGINE_THREADED);
+    }
+    if (args.size() > 0) imem_file = args[0];
+    if (args.size() > 1) dmem_file = args[1];
+    if (args.size() > 2) num_cycles = std::stoull(args[2]);
     
     std::cout << "==== RV32 GOLDEN MODEL ====" << std::endl;
     
@@ -265,12 +1050,53 @@ int main(int argc, char** argv) {
     
     std::cout << "\nRunning for " << num_cycles << " cycles...\n" << std::endl;
     
+    if (!retire_trace_path.empty()) {
+        RetireTraceWriter trace;
+        if (!trace.open(retire_trace_path.c_str())) {
+            return 1;
+        }
+        for (uint64_t cycle = 0; cycle < num_cycles; cycle++) {
+            trace.write(model.step_record());
+        }
+        uint64_t records = trace.records();
+        if (!trace.close()) {
+            std::cerr << "Error: Cannot write " << retire_trace_path << std::endl;
+            return 1;
+        }
+        std::cout << records << " retirements saved to " << retire_trace_path << std::endl;
+        std::cout << "\n==== GOLDEN MODEL COMPLETED ====" << std::endl;
+        return 0;
+    }
+    
     // Execute instructions
-    for (int cycle = 0; cycle < num_cycles; cycle++) {
-        model.step();
-        std::cout << "\n=== Cycle " << cycle << " ===" << std::endl;
-        model.print_state();
+    StateDump dump(stdout);
+    uint32_t regs[16];
+    auto read_registers = [&model](uint32_t* out) {
+        for (int i = 0; i < 16; i++) out[i] = model.get_gpr(i);
+    };
+    if (dump_mode == DUMP_CHANGE) {
+        // Only the register an instruction writes can change, so one
+        // compare per write; the full state is read only to dump it
+        uint32_t last[16];
+        read_registers(last);
+        for (uint64_t cycle = 0; cycle < num_cycles; cycle++) {
+            RetireTraceRecord r = model.step_record();
+            if (r.we && r.wdata != last[r.rd]) {
+                last[r.rd] = r.wdata;
+                dump.write(cycle, r.next_pc, last, diff_only);
+            }
+        }
+    } else {
+        uint64_t batch = dump_mode == DUMP_FINAL ? num_cycles : dump_every;
+        for (uint64_t done = 0; done < num_cycles;) {
+            uint64_t n = num_cycles - done < batch ? num_cycles - done : batch;
+            model.run(n);
+            done += n;
+            read_registers(regs);
+            dump.write(done - 1, model.get_pc(), regs, diff_only);
+        }
     }
+    dump.flush();
     
     std::cout << "\n==== GOLDEN MODEL COMPLETED ====" << std::endl;
     
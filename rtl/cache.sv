@@ -0,0 +1,161 @@
+// Set-associative cache timing model with LRU replacement. It tracks
+// tags, valid and dirty bits only: the data itself stays in the flat
+// memory behind fetch.sv/ram.sv, which the core keeps reading and writing
+// directly. Contents therefore never go stale (stores are seen by fetch
+// at once, as before), and the cache decides how long each access takes
+// and whether it hit. tests/cache_model.h is the golden model's copy;
+// keep the two in step.
+//
+// An access is held on req (with the same addr/write) until ready. A hit
+// is ready in the cycle it is looked up. A miss takes MISS_LATENCY more
+// cycles to fill the line, and MISS_LATENCY again first when a dirty
+// line has to be written back. With WRITE_BACK = 0 stores write through
+// (no dirty lines) and a store miss neither allocates nor waits, as if
+// absorbed by a write buffer. Dropping req abandons a fill.
+module cache #(
+    parameter int SIZE_BYTES = 4096,
+    parameter int WAYS = 2,
+    parameter int LINE_BYTES = 16,
+    parameter int WRITE_BACK = 1,   // 1: write-back, write-allocate
+    parameter int MISS_LATENCY = 10
+) (
+    input logic clk,
+    input logic rst,
+    input logic req,
+    input logic write,
+    input logic [31:0] addr,
+    output logic ready,
+    output logic [63:0] hit_count_out,
+    output logic [63:0] miss_count_out,
+    output logic [63:0] writeback_count_out
+);
+    localparam int SETS = SIZE_BYTES / (WAYS * LINE_BYTES);
+    localparam int OFFSET_BITS = $clog2(LINE_BYTES);
+    localparam int SET_BITS = $clog2(SETS);
+
+    initial begin
+        if (WAYS < 1 || SETS < 1 || (1 << OFFSET_BITS) != LINE_BYTES ||
+            (1 << SET_BITS) != SETS || SETS * WAYS * LINE_BYTES != SIZE_BYTES) begin
+            $fatal(1, "cache: %0d bytes / %0d ways / %0d-byte lines is not a power-of-two geometry",
+                   SIZE_BYTES, WAYS, LINE_BYTES);
+        end
+    end
+
+    logic valid [0:SETS-1][0:WAYS-1];
+    logic dirty [0:SETS-1][0:WAYS-1];
+    logic [31:0] tags [0:SETS-1][0:WAYS-1];
+    // LRU order: each set's ages are a permutation of 0..WAYS-1, 0 being
+    // the most recently used
+    int ages [0:SETS-1][0:WAYS-1];
+
+    int set_idx;
+    logic [31:0] tag;
+    assign set_idx = int'((addr >> OFFSET_BITS) & (SETS - 1));
+    assign tag = addr >> (OFFSET_BITS + SET_BITS);
+
+    logic hit;
+    int hit_way, victim;
+    always_comb begin
+        hit = 1'b0;
+        hit_way = 0;
+        for (int w = WAYS - 1; w >= 0; w--) begin
+            if (valid[set_idx][w] && tags[set_idx][w] == tag) begin
+                hit = 1'b1;
+                hit_way = w;
+            end
+        end
+        // First invalid way, else the least recently used
+        victim = 0;
+        for (int w = WAYS - 1; w >= 0; w--) begin
+            if (ages[set_idx][w] == WAYS - 1) victim = w;
+        end
+        for (int w = WAYS - 1; w >= 0; w--) begin
+            if (!valid[set_idx][w]) victim = w;
+        end
+    end
+
+    // Miss handling: the line being filled and the cycles left
+    logic filling;
+    int wait_count;
+    int fill_set, fill_way;
+    logic [31:0] fill_tag;
+    logic fill_dirty;
+
+    logic wb_needed;        // the victim is dirty and must be written back
+    logic no_allocate;      // write-through store miss
+    int miss_wait;
+    assign wb_needed = WRITE_BACK != 0 && valid[set_idx][victim] && dirty[set_idx][victim];
+    assign no_allocate = WRITE_BACK == 0 && write;
+    assign miss_wait = MISS_LATENCY * (wb_needed ? 2 : 1);
+
+    always_comb begin
+        if (filling) begin
+            ready = wait_count == 0;
+        end else begin
+            ready = req && (hit || no_allocate || miss_wait == 0);
+        end
+    end
+
+    // Make way w of set s the most recently used
+    task automatic touch(input int s, input int w);
+        for (int v = 0; v < WAYS; v++) begin
+            if (ages[s][v] < ages[s][w]) ages[s][v] <= ages[s][v] + 1;
+        end
+        ages[s][w] <= 0;
+    endtask
+
+    // Put the line in way w of set s
+    task automatic install(input int s, input int w, input logic [31:0] t, input logic d);
+        valid[s][w] <= 1'b1;
+        dirty[s][w] <= d;
+        tags[s][w] <= t;
+        touch(s, w);
+    endtask
+
+    always_ff @(posedge clk) begin
+        if (rst) begin
+            for (int s = 0; s < SETS; s++) begin
+                for (int w = 0; w < WAYS; w++) begin
+                    valid[s][w] <= 1'b0;
+                    dirty[s][w] <= 1'b0;
+                    ages[s][w] <= w;
+                end
+            end
+            filling <= 1'b0;
+            wait_count <= 0;
+            hit_count_out <= 64'b0;
+            miss_count_out <= 64'b0;
+            writeback_count_out <= 64'b0;
+        end else if (filling) begin
+            if (!req) begin
+                filling <= 1'b0;
+            end else if (wait_count == 0) begin
+                install(fill_set, fill_way, fill_tag, fill_dirty);
+                filling <= 1'b0;
+            end else begin
+                wait_count <= wait_count - 1;
+            end
+        end else if (req) begin
+            if (hit) begin
+                hit_count_out <= hit_count_out + 64'd1;
+                touch(set_idx, hit_way);
+                if (WRITE_BACK != 0 && write) dirty[set_idx][hit_way] <= 1'b1;
+            end else begin
+                miss_count_out <= miss_count_out + 64'd1;
+                if (!no_allocate) begin
+                    if (wb_needed) writeback_count_out <= writeback_count_out + 64'd1;
+                    if (miss_wait == 0) begin
+                        install(set_idx, victim, tag, WRITE_BACK != 0 && write);
+                    end else begin
+                        filling <= 1'b1;
+                        wait_count <= miss_wait - 1;
+                        fill_set <= set_idx;
+                        fill_way <= victim;
+                        fill_tag <= tag;
+                        fill_dirty <= WRITE_BACK != 0 && write;
+                    end
+                end
+            end
+        end
+    end
+endmodule
@@ -1,18 +1,59 @@
-module core (
+module core #(
+    // Cache geometry and timing (see cache.sv); build.sh overrides these
+    parameter int ICACHE_SIZE = 4096,
+    parameter int ICACHE_WAYS = 2,
+    parameter int ICACHE_LINE = 16,
+    parameter int DCACHE_SIZE = 4096,
+    parameter int DCACHE_WAYS = 2,
+    parameter int DCACHE_LINE = 16,
+    parameter int DCACHE_WRITE_BACK = 1,
+    parameter int MISS_LATENCY = 10
+) (
     input logic clk,
     input logic rst,
+    // Checkpoint restore: while state_load is high the core retires
+    // nothing and each clock loads the PC and all registers
+    input logic state_load,
+    input logic [31:0] state_load_pc,
+    input logic [31:0] state_load_registers [0:15],
     output logic [31:0] registers_out [0:15],
     output logic [31:0] instruction_out,
-    output logic [31:0] pc_out
+    output logic [31:0] pc_out,
+    // Instruction retired at the last clock edge (every cycle out of
+    // reset and state_load that doesn't wait on a cache), and the PC of
+    // the next one in program order
+    output logic retire_valid_out,
+    output logic [31:0] retire_next_pc_out,
+    // Register write retired by the instruction that just completed
+    output logic retire_we_out,
+    output logic [3:0] retire_rd_out,
+    output logic [31:0] retire_data_out,
+    // Store retired by the same instruction (mask selects the bytes)
+    output logic retire_store_out,
+    output logic [31:0] retire_store_addr_out,
+    output logic [31:0] retire_store_data_out,
+    output logic [3:0] retire_store_mask_out,
+    // Retired instructions per class (see perf_counters.sv)
+    output logic [63:0] perf_class_count_out [0:37],
+    // Cache counters (see cache.sv)
+    output logic [63:0] icache_hit_count_out,
+    output logic [63:0] icache_miss_count_out,
+    output logic [63:0] dcache_hit_count_out,
+    output logic [63:0] dcache_miss_count_out,
+    output logic [63:0] dcache_writeback_count_out
 );
     logic [31:0] pc;
     logic branch_enable;
     logic [31:0] branch_target;
+    logic op_valid; // see the decoder below
+    logic stall;    // waiting on a cache: hold the PC, commit nothing
     pc pc_inst (
         .clk(clk),
         .rst(rst),
-        .branch_enable(branch_enable),
-        .branch_target(branch_target),
+        .branch_enable((branch_enable && op_valid) || stall),
+        .branch_target(stall ? pc : branch_target),
+        .load_enable(state_load),
+        .load_value(state_load_pc),
         .pc_out(pc)
     );
     
@@ -25,12 +66,13 @@ module core (
     );
     assign instruction_out = instruction;
     logic [4:0] rs1, rs2, rd;
-    /* verilator lint_off UNUSEDSIGNAL */
     logic [6:0] funct7, opcode;
-    /* verilator lint_on UNUSEDSIGNAL */
     logic [2:0] funct3;
-    logic [11:0] imm_i;
+    logic [11:0] imm_i, imm_s;
+    logic [12:0] imm_b;
     logic [19:0] imm_u;
+    logic [20:0] imm_j;
+    logic [5:0] op_class;
     decoder decoder_inst (
         .instruction(instruction),
         .rs1(rs1),
@@ -40,8 +82,14 @@ module core (
         .funct3(funct3),
         .funct7(funct7),
         .imm_i(imm_i),
-        .imm_u(imm_u)
+        .imm_s(imm_s),
+        .imm_b(imm_b),
+        .imm_u(imm_u),
+        .imm_j(imm_j),
+        .op_class(op_class)
     );
+    // Unsupported encodings execute as NOP: no register write, store or jump
+    assign op_valid = op_class != 6'd37;
 
     logic [31:0] reg_data1, reg_data2, reg_write;
     logic reg_write_enable;
@@ -52,28 +100,36 @@ module core (
         reg_write = 32'b0; // Default write data
         reg_write_enable = 1'b0; // Default write enable
         
-        if(opcode == 7'b0110011 || opcode == 7'b0010011 || opcode == 7'b0110111) begin // add, addi, lui
-            reg_write = execute_result; // Write result from execute stage
-            reg_write_enable = 1'b1; 
-        end else if(opcode == 7'b0000011) begin // lw, lbu
-            reg_write = mem_read_data; // Write data from memory
-            reg_write_enable = 1'b1;
-        end else if(opcode == 7'b1100111) begin // jalr
-            reg_write = execute_result; // Write return address (PC+4)
-            reg_write_enable = 1'b1;
+        if (op_valid && !stall) begin
+            if(opcode == 7'b0110011 || opcode == 7'b0010011 || opcode == 7'b0110111 ||
+               opcode == 7'b0010111) begin // OP, OP-IMM, lui, auipc
+                reg_write = execute_result; // Write result from execute stage
+                reg_write_enable = 1'b1; 
+            end else if(opcode == 7'b0000011) begin // loads
+                reg_write = mem_read_data; // Write data from memory
+                reg_write_enable = 1'b1;
+            end else if(opcode == 7'b1100111 || opcode == 7'b1101111) begin // jalr, jal
+                reg_write = execute_result; // Write return address (PC+4)
+                reg_write_enable = 1'b1;
+            end
         end
 
     end
     logic [31:0] mem_read_data;
+    logic store_enable;
+    logic [31:0] store_data;
+    logic [3:0] store_mask;
+    assign store_enable = !state_load && !stall && op_valid && opcode == 7'b0100011;
     ram ram_inst (
         .clk(clk),
         .address(execute_result), // Address from execute stage
-        .write_data(reg_data2), // sw data from register
-        .w_write_enable(opcode == 7'b0100011 && funct3 == 3'b010), // sw
-        .b_write_enable(opcode == 7'b0100011 && funct3 == 3'b000 ), // sb
-        .read_enable(opcode == 7'b0000011), // lw, lbu
-        .funct3(funct3), // Pass funct3 to distinguish LW vs LBU
-        .read_data(mem_read_data) 
+        .write_data(reg_data2), // store data from register
+        .write_enable(store_enable), // sb, sh, sw
+        .read_enable(opcode == 7'b0000011), // loads
+        .funct3(funct3), // Access size and sign extension
+        .read_data(mem_read_data),
+        .store_data(store_data),
+        .store_mask(store_mask)
     );
     gpr gpr_inst (
         .clk(clk),
@@ -83,16 +139,114 @@ module core (
         .rd(rd),  // Example destination register
         .write_data(reg_write), // Example write data
         .write_enable(reg_write_enable), // Example write enable
+        .load_enable(state_load),
+        .load_data(state_load_registers),
         .read_data1(reg_data1),
         .read_data2(reg_data2),
         .registers_out(registers_out)
     );
+
+    // Caches: the instruction's fetch is looked up first, then its load
+    // or store. Once the fetch is done it is not repeated while the data
+    // access waits, so each access is counted once.
+    logic icache_ready, dcache_ready, dcache_req;
+    logic fetch_done, fetch_ready;
+    assign fetch_ready = fetch_done || icache_ready;
+    assign dcache_req = !state_load && fetch_ready && op_valid &&
+                        (opcode == 7'b0000011 || opcode == 7'b0100011);
+    assign stall = !state_load && (!fetch_ready || (dcache_req && !dcache_ready));
+
+    always_ff @(posedge clk) begin
+        if (rst || state_load) begin
+            fetch_done <= 1'b0;
+        end else begin
+            fetch_done <= fetch_ready && stall;
+        end
+    end
+
+    /* verilator lint_off PINCONNECTEMPTY */
+    cache #(
+        .SIZE_BYTES(ICACHE_SIZE),
+        .WAYS(ICACHE_WAYS),
+        .LINE_BYTES(ICACHE_LINE),
+        .MISS_LATENCY(MISS_LATENCY)
+    ) icache_inst (
+        .clk(clk),
+        .rst(rst),
+        .req(!state_load && !fetch_done),
+        .write(1'b0),
+        .addr(pc),
+        .ready(icache_ready),
+        .hit_count_out(icache_hit_count_out),
+        .miss_count_out(icache_miss_count_out),
+        .writeback_count_out()
+    );
+    /* verilator lint_on PINCONNECTEMPTY */
+
+    cache #(
+        .SIZE_BYTES(DCACHE_SIZE),
+        .WAYS(DCACHE_WAYS),
+        .LINE_BYTES(DCACHE_LINE),
+        .WRITE_BACK(DCACHE_WRITE_BACK),
+        .MISS_LATENCY(MISS_LATENCY)
+    ) dcache_inst (
+        .clk(clk),
+        .rst(rst),
+        .req(dcache_req),
+        .write(opcode == 7'b0100011),
+        .addr(execute_result),
+        .ready(dcache_ready),
+        .hit_count_out(dcache_hit_count_out),
+        .miss_count_out(dcache_miss_count_out),
+        .writeback_count_out(dcache_writeback_count_out)
+    );
+
+    // Latch the register write and store at the clock edge that commits
+    // them, so the testbench can check one delta per cycle instead of all
+    // 16 registers
+    assign retire_next_pc_out = pc;
+    always_ff @(posedge clk) begin
+        if (rst || state_load) begin
+            retire_valid_out <= 1'b0;
+            retire_we_out <= 1'b0;
+            retire_rd_out <= 4'b0;
+            retire_data_out <= 32'b0;
+            retire_store_out <= 1'b0;
+            retire_store_addr_out <= 32'b0;
+            retire_store_data_out <= 32'b0;
+            retire_store_mask_out <= 4'b0;
+        end else begin
+            retire_valid_out <= !stall;
+            retire_we_out <= reg_write_enable && rd[3:0] != 4'b0;
+            retire_rd_out <= rd[3:0];
+            retire_data_out <= reg_write;
+            retire_store_out <= store_enable;
+            retire_store_addr_out <= execute_result;
+            retire_store_data_out <= store_data;
+            retire_store_mask_out <= store_mask;
+        end
+    end
+    // Single-cycle core: every clock out of reset and state_load retires
+    // one instruction, unless it waits on a cache
+    perf_counters perf_inst (
+        .clk(clk),
+        .rst(rst),
+        .retire(!state_load && !stall),
+        .op_class(op_class),
+        .class_count_out(perf_class_count_out)
+    );
+
     execute execute_inst (
         .reg_data1(reg_data1),
         .reg_data2(reg_data2),
         .imm_i(imm_i),
+        .imm_s(imm_s),
+        .imm_b(imm_b),
         .imm_u(imm_u),
+        .imm_j(imm_j),
         .opcode(opcode),
+        .funct3(funct3),
+        .funct7(funct7),
         .pc_in(pc),
         .result(execute_result),
         .branch_target(branch_target),
@@ -0,0 +1,440 @@
+// Five-stage pipelined variant of core.sv (IF/ID/EX/MEM/WB) built from
+// the same fetch/decoder/execute/ram/gpr modules, with the same ports.
+//   - Operands are forwarded from EX/MEM and MEM/WB into EX, and the
+//     register being written back is bypassed into ID.
+//   - A load followed by a user of its result stalls IF and ID for one
+//     cycle.
+//   - Jumps and branches resolve in EX (fetch predicts not-taken); a
+//     redirect flushes the two younger instructions.
+//   - A store to a word that a younger instruction was already fetched
+//     from flushes everything behind it and refetches, so self-modifying
+//     code behaves as on the single-cycle core.
+//   - IF and MEM go through the I-cache and D-cache (cache.sv); while
+//     either waits on a miss the whole pipeline is frozen. Fetches that
+//     a stall or redirect would discard skip the I-cache, but fetches
+//     down a path that is flushed later still count.
+// Instructions retire in WB. retire_valid_out says whether one retired
+// at the last clock edge; the other retire_* outputs describe it.
+// pc_out/instruction_out show the fetch stage.
+module core_pipe #(
+    // Cache geometry and timing, as in core.sv
+    parameter int ICACHE_SIZE = 4096,
+    parameter int ICACHE_WAYS = 2,
+    parameter int ICACHE_LINE = 16,
+    parameter int DCACHE_SIZE = 4096,
+    parameter int DCACHE_WAYS = 2,
+    parameter int DCACHE_LINE = 16,
+    parameter int DCACHE_WRITE_BACK = 1,
+    parameter int MISS_LATENCY = 10
+) (
+    input logic clk,
+    input logic rst,
+    // Checkpoint restore: while state_load is high the pipeline is
+    // emptied and each clock loads the PC and all registers
+    input logic state_load,
+    input logic [31:0] state_load_pc,
+    input logic [31:0] state_load_registers [0:15],
+    output logic [31:0] registers_out [0:15],
+    output logic [31:0] instruction_out,
+    output logic [31:0] pc_out,
+    // Instruction retired at the last clock edge, and the PC of the next
+    // one in program order (the architectural PC)
+    output logic retire_valid_out,
+    output logic [31:0] retire_next_pc_out,
+    // Register write retired by that instruction
+    output logic retire_we_out,
+    output logic [3:0] retire_rd_out,
+    output logic [31:0] retire_data_out,
+    // Store retired by the same instruction (mask selects the bytes)
+    output logic retire_store_out,
+    output logic [31:0] retire_store_addr_out,
+    output logic [31:0] retire_store_data_out,
+    output logic [3:0] retire_store_mask_out,
+    // Retired instructions per class (see perf_counters.sv)
+    output logic [63:0] perf_class_count_out [0:37],
+    // Cache counters (see cache.sv)
+    output logic [63:0] icache_hit_count_out,
+    output logic [63:0] icache_miss_count_out,
+    output logic [63:0] dcache_hit_count_out,
+    output logic [63:0] dcache_miss_count_out,
+    output logic [63:0] dcache_writeback_count_out
+);
+    localparam logic [6:0] OPC_OP     = 7'b0110011;
+    localparam logic [6:0] OPC_OP_IMM = 7'b0010011;
+    localparam logic [6:0] OPC_LUI    = 7'b0110111;
+    localparam logic [6:0] OPC_AUIPC  = 7'b0010111;
+    localparam logic [6:0] OPC_JAL    = 7'b1101111;
+    localparam logic [6:0] OPC_JALR   = 7'b1100111;
+    localparam logic [6:0] OPC_LOAD   = 7'b0000011;
+    localparam logic [6:0] OPC_STORE  = 7'b0100011;
+    localparam logic [5:0] CLASS_OTHER = 6'd37;
+
+    // Hazard and redirect signals, driven further down
+    logic stall;            // load-use: hold IF and ID, bubble into EX
+    logic ex_redirect;      // jump or taken branch in EX
+    logic [31:0] ex_target;
+    logic smc_flush;        // store in MEM overwrites a fetched instruction
+    logic freeze;           // waiting on a cache: nothing moves
+
+    // ------------------------------------------------------------------
+    // IF
+    // ------------------------------------------------------------------
+    logic [31:0] pc;
+    logic [31:0] instruction;
+    logic [31:0] ex_mem_pc;
+    pc pc_inst (
+        .clk(clk),
+        .rst(rst),
+        // A stall or freeze re-targets the PC at itself
+        .branch_enable(freeze || smc_flush || ex_redirect || stall),
+        .branch_target(freeze ? pc : smc_flush ? ex_mem_pc + 4 : ex_redirect ? ex_target : pc),
+        .load_enable(state_load),
+        .load_value(state_load_pc),
+        .pc_out(pc)
+    );
+    assign pc_out = pc;
+
+    fetch fetch_inst (
+        .pc_in(pc),
+        .instruction_out(instruction)
+    );
+    assign instruction_out = instruction;
+
+    logic if_id_valid;
+    logic [31:0] if_id_pc, if_id_instr;
+
+    // ------------------------------------------------------------------
+    // ID
+    // ------------------------------------------------------------------
+    logic [4:0] rs1, rs2, rd;
+    logic [6:0] funct7, opcode;
+    logic [2:0] funct3;
+    logic [11:0] imm_i, imm_s;
+    logic [12:0] imm_b;
+    logic [19:0] imm_u;
+    logic [20:0] imm_j;
+    logic [5:0] op_class;
+    decoder decoder_inst (
+        .instruction(if_id_instr),
+        .rs1(rs1),
+        .rs2(rs2),
+        .rd(rd),
+        .opcode(opcode),
+        .funct3(funct3),
+        .funct7(funct7),
+        .imm_i(imm_i),
+        .imm_s(imm_s),
+        .imm_b(imm_b),
+        .imm_u(imm_u),
+        .imm_j(imm_j),
+        .op_class(op_class)
+    );
+
+    // Write-back port, driven from MEM/WB
+    logic mem_wb_valid, mem_wb_we;
+    logic [3:0] mem_wb_rd;
+    logic [31:0] mem_wb_data;
+
+    logic [31:0] reg_data1, reg_data2;
+    gpr gpr_inst (
+        .clk(clk),
+        .rst(rst),
+        .rs1(rs1),
+        .rs2(rs2),
+        .rd({1'b0, mem_wb_rd}),
+        .write_data(mem_wb_data),
+        .write_enable(mem_wb_valid && mem_wb_we && !freeze),
+        .load_enable(state_load),
+        .load_data(state_load_registers),
+        .read_data1(reg_data1),
+        .read_data2(reg_data2),
+        .registers_out(registers_out)
+    );
+
+    // The register file is written at the end of WB; bypass that write
+    // so ID reads the value it is about to hold. Registers alias on
+    // their low 4 bits, as in gpr.sv.
+    logic wb_writes;
+    logic [31:0] id_rs1_data, id_rs2_data;
+    assign wb_writes = mem_wb_valid && mem_wb_we && mem_wb_rd != 4'b0;
+    assign id_rs1_data = (wb_writes && mem_wb_rd == rs1[3:0]) ? mem_wb_data : reg_data1;
+    assign id_rs2_data = (wb_writes && mem_wb_rd == rs2[3:0]) ? mem_wb_data : reg_data2;
+
+    logic id_ex_valid;
+    logic [31:0] id_ex_pc;
+    logic [3:0] id_ex_rd, id_ex_rs1, id_ex_rs2;
+    logic [6:0] id_ex_opcode, id_ex_funct7;
+    logic [2:0] id_ex_funct3;
+    logic [11:0] id_ex_imm_i, id_ex_imm_s;
+    logic [12:0] id_ex_imm_b;
+    logic [19:0] id_ex_imm_u;
+    logic [20:0] id_ex_imm_j;
+    logic [5:0] id_ex_op_class;
+    logic [31:0] id_ex_rs1_data, id_ex_rs2_data;
+
+    // Load-use hazard: the loaded value only exists at the end of MEM.
+    // rs1/rs2 are compared even for formats that don't read them, which
+    // costs the odd needless stall but nothing else.
+    assign stall = if_id_valid && id_ex_valid && id_ex_opcode == OPC_LOAD &&
+                   id_ex_op_class != CLASS_OTHER && id_ex_rd != 4'b0 &&
+                   (id_ex_rd == rs1[3:0] || id_ex_rd == rs2[3:0]);
+
+    // ------------------------------------------------------------------
+    // EX
+    // ------------------------------------------------------------------
+    logic ex_mem_valid, ex_mem_we, ex_mem_load;
+    logic [3:0] ex_mem_rd;
+    logic [31:0] ex_mem_result;
+
+    // Forward the newest value: EX/MEM (never a load, see stall), then
+    // MEM/WB, then what ID read
+    logic [31:0] ex_rs1_data, ex_rs2_data;
+    always_comb begin
+        if (ex_mem_valid && ex_mem_we && !ex_mem_load && ex_mem_rd != 4'b0 &&
+            ex_mem_rd == id_ex_rs1) begin
+            ex_rs1_data = ex_mem_result;
+        end else if (wb_writes && mem_wb_rd == id_ex_rs1) begin
+            ex_rs1_data = mem_wb_data;
+        end else begin
+            ex_rs1_data = id_ex_rs1_data;
+        end
+        if (ex_mem_valid && ex_mem_we && !ex_mem_load && ex_mem_rd != 4'b0 &&
+            ex_mem_rd == id_ex_rs2) begin
+            ex_rs2_data = ex_mem_result;
+        end else if (wb_writes && mem_wb_rd == id_ex_rs2) begin
+            ex_rs2_data = mem_wb_data;
+        end else begin
+            ex_rs2_data = id_ex_rs2_data;
+        end
+    end
+
+    logic [31:0] ex_result;
+    logic ex_branch_enable;
+    execute execute_inst (
+        .reg_data1(ex_rs1_data),
+        .reg_data2(ex_rs2_data),
+        .imm_i(id_ex_imm_i),
+        .imm_s(id_ex_imm_s),
+        .imm_b(id_ex_imm_b),
+        .imm_u(id_ex_imm_u),
+        .imm_j(id_ex_imm_j),
+        .opcode(id_ex_opcode),
+        .funct3(id_ex_funct3),
+        .funct7(id_ex_funct7),
+        .pc_in(id_ex_pc),
+        .result(ex_result),
+        .branch_target(ex_target),
+        .branch_enable(ex_branch_enable)
+    );
+
+    // Unsupported encodings execute as NOP: no register write, store or jump
+    logic ex_op_valid, ex_we, ex_jump;
+    assign ex_op_valid = id_ex_op_class != CLASS_OTHER;
+    assign ex_jump = id_ex_valid && ex_op_valid && ex_branch_enable;
+    assign ex_redirect = ex_jump && !smc_flush;
+    assign ex_we = ex_op_valid &&
+                   (id_ex_opcode == OPC_OP || id_ex_opcode == OPC_OP_IMM ||
+                    id_ex_opcode == OPC_LUI || id_ex_opcode == OPC_AUIPC ||
+                    id_ex_opcode == OPC_JAL || id_ex_opcode == OPC_JALR ||
+                    id_ex_opcode == OPC_LOAD);
+
+    logic ex_mem_store;
+    logic [2:0] ex_mem_funct3;
+    logic [31:0] ex_mem_next_pc, ex_mem_rs2_data;
+    logic [5:0] ex_mem_op_class;
+
+    // ------------------------------------------------------------------
+    // MEM
+    // ------------------------------------------------------------------
+    logic [31:0] mem_read_data, store_data;
+    logic [3:0] store_mask;
+    logic mem_store_enable;
+    assign mem_store_enable = ex_mem_valid && ex_mem_store && !state_load && !freeze;
+    ram ram_inst (
+        .clk(clk),
+        .address(ex_mem_result),
+        .write_data(ex_mem_rs2_data),
+        .write_enable(mem_store_enable),
+        .read_enable(ex_mem_load),
+        .funct3(ex_mem_funct3),
+        .read_data(mem_read_data),
+        .store_data(store_data),
+        .store_mask(store_mask)
+    );
+
+    // The store lands at this clock edge; anything younger that was
+    // fetched from the same word holds the old instruction
+    assign smc_flush = mem_store_enable &&
+        ((id_ex_valid && id_ex_pc[31:2] == ex_mem_result[31:2]) ||
+         (if_id_valid && if_id_pc[31:2] == ex_mem_result[31:2]) ||
+         pc[31:2] == ex_mem_result[31:2]);
+
+    logic [31:0] mem_wb_next_pc;
+    logic mem_wb_store;
+    logic [31:0] mem_wb_store_addr, mem_wb_store_data;
+    logic [3:0] mem_wb_store_mask;
+    logic [5:0] mem_wb_op_class;
+
+    // ------------------------------------------------------------------
+    // Caches. The fetch and the MEM access are looked up in parallel;
+    // whichever finishes first is not repeated while the pipeline stays
+    // frozen for the other, so each access is counted once.
+    // ------------------------------------------------------------------
+    logic icache_ready, dcache_ready;
+    logic fetch_done, mem_done;
+    logic fetch_ready, mem_access, mem_ready;
+    assign fetch_ready = fetch_done || icache_ready || stall || ex_jump;
+    assign mem_access = ex_mem_valid && (ex_mem_load || ex_mem_store);
+    assign mem_ready = !mem_access || mem_done || dcache_ready;
+    assign freeze = !state_load && (!fetch_ready || !mem_ready);
+
+    always_ff @(posedge clk) begin
+        if (rst || state_load) begin
+            fetch_done <= 1'b0;
+            mem_done <= 1'b0;
+        end else begin
+            fetch_done <= fetch_ready && freeze;
+            mem_done <= mem_access && mem_ready && freeze;
+        end
+    end
+
+    /* verilator lint_off PINCONNECTEMPTY */
+    cache #(
+        .SIZE_BYTES(ICACHE_SIZE),
+        .WAYS(ICACHE_WAYS),
+        .LINE_BYTES(ICACHE_LINE),
+        .MISS_LATENCY(MISS_LATENCY)
+    ) icache_inst (
+        .clk(clk),
+        .rst(rst),
+        .req(!state_load && !fetch_done && !stall && !ex_jump),
+        .write(1'b0),
+        .addr(pc),
+        .ready(icache_ready),
+        .hit_count_out(icache_hit_count_out),
+        .miss_count_out(icache_miss_count_out),
+        .writeback_count_out()
+    );
+    /* verilator lint_on PINCONNECTEMPTY */
+
+    cache #(
+        .SIZE_BYTES(DCACHE_SIZE),
+        .WAYS(DCACHE_WAYS),
+        .LINE_BYTES(DCACHE_LINE),
+        .WRITE_BACK(DCACHE_WRITE_BACK),
+        .MISS_LATENCY(MISS_LATENCY)
+    ) dcache_inst (
+        .clk(clk),
+        .rst(rst),
+        .req(!state_load && mem_access && !mem_done),
+        .write(ex_mem_store),
+        .addr(ex_mem_result),
+        .ready(dcache_ready),
+        .hit_count_out(dcache_hit_count_out),
+        .miss_count_out(dcache_miss_count_out),
+        .writeback_count_out(dcache_writeback_count_out)
+    );
+
+    // ------------------------------------------------------------------
+    // Pipeline registers
+    // ------------------------------------------------------------------
+    always_ff @(posedge clk) begin
+        if (rst || state_load) begin
+            if_id_valid <= 1'b0;
+            id_ex_valid <= 1'b0;
+            ex_mem_valid <= 1'b0;
+            mem_wb_valid <= 1'b0;
+        end else if (!freeze) begin
+            // IF -> ID
+            if (smc_flush || ex_redirect) begin
+                if_id_valid <= 1'b0;
+            end else if (!stall) begin
+                if_id_valid <= 1'b1;
+                if_id_pc <= pc;
+                if_id_instr <= instruction;
+            end
+
+            // ID -> EX
+            id_ex_valid <= if_id_valid && !stall && !smc_flush && !ex_redirect;
+            id_ex_pc <= if_id_pc;
+            id_ex_rd <= rd[3:0];
+            id_ex_rs1 <= rs1[3:0];
+            id_ex_rs2 <= rs2[3:0];
+            id_ex_opcode <= opcode;
+            id_ex_funct3 <= funct3;
+            id_ex_funct7 <= funct7;
+            id_ex_imm_i <= imm_i;
+            id_ex_imm_s <= imm_s;
+            id_ex_imm_b <= imm_b;
+            id_ex_imm_u <= imm_u;
+            id_ex_imm_j <= imm_j;
+            id_ex_op_class <= op_class;
+            id_ex_rs1_data <= id_rs1_data;
+            id_ex_rs2_data <= id_rs2_data;
+
+            // EX -> MEM
+            ex_mem_valid <= id_ex_valid && !smc_flush;
+            ex_mem_pc <= id_ex_pc;
+            ex_mem_next_pc <= (ex_op_valid && ex_branch_enable) ? ex_target : id_ex_pc + 4;
+            ex_mem_rd <= id_ex_rd;
+            ex_mem_we <= ex_we;
+            ex_mem_load <= ex_op_valid && id_ex_opcode == OPC_LOAD;
+            ex_mem_store <= ex_op_valid && id_ex_opcode == OPC_STORE;
+            ex_mem_funct3 <= id_ex_funct3;
+            ex_mem_result <= ex_result;
+            ex_mem_rs2_data <= ex_rs2_data;
+            ex_mem_op_class <= id_ex_op_class;
+
+            // MEM -> WB
+            mem_wb_valid <= ex_mem_valid;
+            mem_wb_next_pc <= ex_mem_next_pc;
+            mem_wb_rd <= ex_mem_rd;
+            mem_wb_we <= ex_mem_we;
+            mem_wb_data <= ex_mem_load ? mem_read_data : ex_mem_result;
+            mem_wb_store <= ex_mem_store;
+            mem_wb_store_addr <= ex_mem_result;
+            mem_wb_store_data <= store_data;
+            mem_wb_store_mask <= store_mask;
+            mem_wb_op_class <= ex_mem_op_class;
+        end
+    end
+
+    // ------------------------------------------------------------------
+    // WB: retirement outputs, latched at the edge that writes the
+    // register file
+    // ------------------------------------------------------------------
+    always_ff @(posedge clk) begin
+        if (rst || state_load) begin
+            retire_valid_out <= 1'b0;
+            retire_next_pc_out <= rst ? 32'b0 : state_load_pc;
+            retire_we_out <= 1'b0;
+            retire_rd_out <= 4'b0;
+            retire_data_out <= 32'b0;
+            retire_store_out <= 1'b0;
+            retire_store_addr_out <= 32'b0;
+            retire_store_data_out <= 32'b0;
+            retire_store_mask_out <= 4'b0;
+        end else begin
+            retire_valid_out <= mem_wb_valid && !freeze;
+            if (mem_wb_valid && !freeze) begin
+                retire_next_pc_out <= mem_wb_next_pc;
+            end
+            retire_we_out <= wb_writes && !freeze;
+            retire_rd_out <= mem_wb_rd;
+            retire_data_out <= mem_wb_data;
+            retire_store_out <= mem_wb_valid && mem_wb_store && !freeze;
+            retire_store_addr_out <= mem_wb_store_addr;
+            retire_store_data_out <= mem_wb_store_data;
+            retire_store_mask_out <= mem_wb_store_mask;
+        end
+    end
+
+    perf_counters perf_inst (
+        .clk(clk),
+        .rst(rst),
+        .retire(mem_wb_valid && !state_load && !freeze),
+        .op_class(mem_wb_op_class),
+        .class_count_out(perf_class_count_out)
+    );
+
+endmodule
@@ -7,7 +7,13 @@ module decoder (
     output logic [2:0] funct3,
     output logic [6:0] funct7,
     output logic [11:0] imm_i,
-    output logic [19:0] imm_u
+    output logic [11:0] imm_s,
+    output logic [12:0] imm_b,
+    output logic [19:0] imm_u,
+    output logic [20:0] imm_j,
+    // Operation, numbered like Rv32Op in tests/rv32_decoder.h;
+    // 37 = unsupported (FENCE, ECALL, EBREAK, unknown), executed as NOP
+    output logic [5:0] op_class
 );
     always_comb begin
         rs1    = instruction[19:15];
@@ -17,6 +23,81 @@ module decoder (
         funct3  = instruction[14:12];
         funct7  = instruction[31:25];
         imm_i    = instruction[31:20]; // Example for I-type immediate
+        imm_s    = {instruction[31:25], instruction[11:7]};
+        imm_b    = {instruction[31], instruction[7], instruction[30:25], instruction[11:8], 1'b0};
         imm_u    = instruction[31:12]; // Example for U-type immediate
+        imm_j    = {instruction[31], instruction[19:12], instruction[20], instruction[30:21], 1'b0};
+    end
+
+    always_comb begin
+        op_class = 6'd37;
+        case (opcode)
+            7'b0110011: begin // OP
+                if (funct7 == 7'b0000000) begin
+                    case (funct3)
+                        3'b000: op_class = 6'd0;  // add
+                        3'b001: op_class = 6'd9;  // sll
+                        3'b010: op_class = 6'd10; // slt
+                        3'b011: op_class = 6'd11; // sltu
+                        3'b100: op_class = 6'd12; // xor
+                        3'b101: op_class = 6'd13; // srl
+                        3'b110: op_class = 6'd15; // or
+                        3'b111: op_class = 6'd16; // and
+                    endcase
+                end else if (funct7 == 7'b0100000) begin
+                    if (funct3 == 3'b000) op_class = 6'd8;       // sub
+                    else if (funct3 == 3'b101) op_class = 6'd14; // sra
+                end
+            end
+            7'b0010011: begin // OP-IMM
+                case (funct3)
+                    3'b000: op_class = 6'd1;  // addi
+                    3'b001: if (funct7 == 7'b0000000) op_class = 6'd22; // slli
+                    3'b010: op_class = 6'd17; // slti
+                    3'b011: op_class = 6'd18; // sltiu
+                    3'b100: op_class = 6'd19; // xori
+                    3'b101: begin
+                        if (funct7 == 7'b0000000) op_class = 6'd23;      // srli
+                        else if (funct7 == 7'b0100000) op_class = 6'd24; // srai
+                    end
+                    3'b110: op_class = 6'd20; // ori
+                    3'b111: op_class = 6'd21; // andi
+                endcase
+            end
+            7'b0110111: op_class = 6'd2;  // lui
+            7'b0010111: op_class = 6'd25; // auipc
+            7'b1101111: op_class = 6'd26; // jal
+            7'b1100111: if (funct3 == 3'b000) op_class = 6'd7; // jalr
+            7'b1100011: begin // BRANCH
+                case (funct3)
+                    3'b000: op_class = 6'd27; // beq
+                    3'b001: op_class = 6'd28; // bne
+                    3'b100: op_class = 6'd29; // blt
+                    3'b101: op_class = 6'd30; // bge
+                    3'b110: op_class = 6'd31; // bltu
+                    3'b111: op_class = 6'd32; // bgeu
+                    default: op_class = 6'd37;
+                endcase
+            end
+            7'b0000011: begin // LOAD
+                case (funct3)
+                    3'b000: op_class = 6'd33; // lb
+                    3'b001: op_class = 6'd34; // lh
+                    3'b010: op_class = 6'd3;  // lw
+                    3'b100: op_class = 6'd4;  // lbu
+                    3'b101: op_class = 6'd35; // lhu
+                    default: op_class = 6'd37;
+                endcase
+            end
+            7'b0100011: begin // STORE
+                case (funct3)
+                    3'b000: op_class = 6'd6;  // sb
+                    3'b001: op_class = 6'd36; // sh
+                    3'b010: op_class = 6'd5;  // sw
+                    default: op_class = 6'd37;
+                endcase
+            end
+            default: op_class = 6'd37;
+        endcase
     end
 endmodule
@@ -2,40 +2,108 @@ module execute (
     input logic [31:0] reg_data1,
     input logic [31:0] reg_data2,
     input logic [11:0] imm_i,
+    input logic [11:0] imm_s,
+    input logic [12:0] imm_b,
     input logic [19:0] imm_u,
+    input logic [20:0] imm_j,
     input logic [6:0] opcode,
+    input logic [2:0] funct3,
+    /* verilator lint_off UNUSEDSIGNAL */
+    input logic [6:0] funct7,
+    /* verilator lint_on UNUSEDSIGNAL */
     input logic [31:0] pc_in,
     output logic [31:0] result,
     output logic [31:0] branch_target,
     output logic branch_enable
 );
+    logic [31:0] imm_i_ext;
+    logic [31:0] alu_b;
+    logic [4:0] shamt;
+    logic alt; // funct7[5]: SUB instead of ADD, SRA instead of SRL
+    logic [31:0] sra_result;
+    logic [31:0] alu_result;
+    logic branch_taken;
+
+    assign imm_i_ext = {{20{imm_i[11]}}, imm_i};
+
+    // ALU shared by the register (OP) and immediate (OP-IMM) forms; the
+    // immediate forms have no SUB, but SRAI sets funct7[5] like SRA
+    assign alu_b = (opcode == 7'b0110011) ? reg_data2 : imm_i_ext;
+    assign shamt = alu_b[4:0];
+    assign alt = funct7[5];
+    // Arithmetic shift on its own: inside the ?: below the unsigned SRL
+    // operand would make >>> shift in zeros
+    assign sra_result = $signed(reg_data1) >>> shamt;
+
+    always_comb begin
+        case (funct3)
+            3'b000: alu_result = (opcode == 7'b0110011 && alt) ? reg_data1 - alu_b
+                                                               : reg_data1 + alu_b;
+            3'b001: alu_result = reg_data1 << shamt;
+            3'b010: alu_result = {31'b0, $signed(reg_data1) < $signed(alu_b)};
+            3'b011: alu_result = {31'b0, reg_data1 < alu_b};
+            3'b100: alu_result = reg_data1 ^ alu_b;
+            3'b101: alu_result = alt ? sra_result : reg_data1 >> shamt;
+            3'b110: alu_result = reg_data1 | alu_b;
+            3'b111: alu_result = reg_data1 & alu_b;
+        endcase
+    end
+
+    always_comb begin
+        case (funct3)
+            3'b000: branch_taken = reg_data1 == reg_data2;                   // beq
+            3'b001: branch_taken = reg_data1 != reg_data2;                   // bne
+            3'b100: branch_taken = $signed(reg_data1) < $signed(reg_data2);  // blt
+            3'b101: branch_taken = $signed(reg_data1) >= $signed(reg_data2); // bge
+            3'b110: branch_taken = reg_data1 < reg_data2;                    // bltu
+            3'b111: branch_taken = reg_data1 >= reg_data2;                   // bgeu
+            default: branch_taken = 1'b0;
+        endcase
+    end
+
     always_comb begin
         // Default values
         branch_enable = 1'b0;
         branch_target = 32'b0;
-        
-        case (opcode)
-            7'b0110011: begin // R-type ADD
-                result = reg_data1 + reg_data2;
-            end
 
-            7'b0010011: begin // ADDI
-                result = reg_data1 + {{20{imm_i[11]}}, imm_i};
+        case (opcode)
+            7'b0110011,
+            7'b0010011: begin // OP / OP-IMM
+                result = alu_result;
             end
 
             7'b0110111: begin // LUI
                 result = {imm_u, 12'b0};
             end
 
+            7'b0010111: begin // AUIPC
+                result = pc_in + {imm_u, 12'b0};
+            end
+
+            7'b1101111: begin // JAL
+                result = pc_in + 4; // Return address (PC+4)
+                branch_target = pc_in + {{11{imm_j[20]}}, imm_j};
+                branch_enable = 1'b1;
+            end
+
             7'b1100111: begin // JALR
                 result = pc_in + 4; // Return address (PC+4)
-                branch_target = (reg_data1 + {{20{imm_i[11]}}, imm_i}) & ~32'b1; // Target address, clear LSB
+                branch_target = (reg_data1 + imm_i_ext) & ~32'b1; // Target address, clear LSB
                 branch_enable = 1'b1;
             end
 
-            7'b0000011,
-            7'b0100011: begin // Load / Store address calc
-                result = reg_data1 + {{20{imm_i[11]}}, imm_i};
+            7'b1100011: begin // Branches
+                result = 32'b0;
+                branch_target = pc_in + {{19{imm_b[12]}}, imm_b};
+                branch_enable = branch_taken;
+            end
+
+            7'b0000011: begin // Load address calc
+                result = reg_data1 + imm_i_ext;
+            end
+
+            7'b0100011: begin // Store address calc
+                result = reg_data1 + {{20{imm_s[11]}}, imm_s};
             end
 
             default: begin
@@ -5,16 +5,22 @@ module fetch (
     output logic [31:0] instruction_out
 );
 
-    import "DPI-C" function void mem_init(string path);
-    import "DPI-C" function int mem_read(int addr);
+    // mem_attach (context) finds the Memory bound to this instance once;
+    // every fetch then goes straight to it through a plain call. Not
+    // pure: the result depends on stores made since the last read.
+    import "DPI-C" context function chandle mem_attach(string path);
+    import "DPI-C" function int mem_read_h(chandle mem, int addr);
+
+    chandle mem;
 
     initial begin
-        mem_init("/Users/sayat/Documents/GitHub/bootcamp_rv5/imem.hex");
+        // "" loads imem.hex from the simulator's working directory
+        mem = mem_attach("");
     end
 
     always_comb begin
-        // Word-aligned read; mem_read handles alignment internally
-        instruction_out = mem_read(pc_in);
+        // Word-aligned read; mem_read_h handles alignment internally
+        instruction_out = mem_read_h(mem, pc_in);
         // if((pc_in - 4) % 40000 == 0)
         //     $display("FETCH: PC=0x%08h INSTR=0x%08h", pc_in, instruction_out);
     end
@@ -8,6 +8,9 @@ module gpr (
     /* verilator lint_on UNUSEDSIGNAL */
     input logic [31:0] write_data,
     input logic write_enable,
+    // Checkpoint restore: load all registers at once (x0 stays zero)
+    input logic load_enable,
+    input logic [31:0] load_data [0:15],
     output logic [31:0] read_data1,
     output logic [31:0] read_data2,
     output logic [31:0] registers_out [0:15]
@@ -26,6 +29,12 @@ module gpr (
             for (i = 0; i < 16; i = i + 1) begin
                 registers[i] <= 32'b0;
             end
+        end else if (load_enable) begin
+            integer i;
+            registers[0] <= 32'b0;
+            for (i = 1; i < 16; i = i + 1) begin
+                registers[i] <= load_data[i];
+            end
         end else if (write_enable && rd[3:0] != 4'b0) begin
             // Prevent writes to x0 (hardwired to 0 in RISC-V)
             registers[rd[3:0]] <= write_data;
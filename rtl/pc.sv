@@ -3,6 +3,9 @@ module pc (
     input logic rst,
     input logic branch_enable,
     input logic [31:0] branch_target,
+    // Checkpoint restore: load_value becomes the PC
+    input logic load_enable,
+    input logic [31:0] load_value,
     output logic [31:0] pc_out
 );
     logic [31:0] pc_reg;
@@ -10,6 +13,8 @@ module pc (
     always_ff @(posedge clk) begin
         if (rst) begin
             pc_reg <= 32'b0;
+        end else if (load_enable) begin
+            pc_reg <= load_value;
         end else if (branch_enable) begin
             pc_reg <= branch_target; // Jump to target address
         end else begin
@@ -0,0 +1,29 @@
+// Retired-instruction counters by class. Classes are decoder.sv's
+// op_class, so they and their order match the golden model's profile
+// (tests/core_profile.h, Rv32Op in tests/rv32_decoder.h):
+//   0 add, 1 addi, 2 lui, 3 lw, 4 lbu, 5 sw, 6 sb, 7 jalr, 8 sub, ...,
+//   36 sh, 37 other
+module perf_counters #(
+    parameter int NUM_CLASSES = 38
+) (
+    input logic clk,
+    input logic rst,
+    input logic retire, // an instruction completes this cycle
+    input logic [5:0] op_class,
+    output logic [63:0] class_count_out [0:NUM_CLASSES-1]
+);
+    logic [63:0] counts [0:NUM_CLASSES-1];
+
+    always_ff @(posedge clk) begin
+        if (rst) begin
+            integer i;
+            for (i = 0; i < NUM_CLASSES; i = i + 1) begin
+                counts[i] <= 64'b0;
+            end
+        end else if (retire) begin
+            counts[op_class] <= counts[op_class] + 64'd1;
+        end
+    end
+
+    assign class_count_out = counts;
+endmodule
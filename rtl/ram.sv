@@ -2,39 +2,47 @@ module ram (
     input logic clk,
     input logic [31:0] address,
     input logic [31:0] write_data,
-    input logic w_write_enable,
-    input logic b_write_enable,
+    input logic write_enable, // store; funct3 selects sb/sh/sw
     input logic read_enable,
     input logic [2:0] funct3,
-    output logic [31:0] read_data
+    output logic [31:0] read_data,
+    // The store as written: write_data moved into its byte lanes, and
+    // the lanes it covers (for the core's retirement outputs)
+    output logic [31:0] store_data,
+    output logic [3:0] store_mask
 );
-    import "DPI-C" function void mem_init(string path);
-    import "DPI-C" function int  mem_read(int addr);
-    import "DPI-C" function void mem_write(int addr, int data, byte wmask);
+    // mem_attach (context) finds the Memory bound to this instance once;
+    // reads and writes then go straight to it without a scope lookup
+    import "DPI-C" context function chandle mem_attach(string path);
+    import "DPI-C" function int  mem_read_h(chandle mem, int addr);
+    import "DPI-C" function void mem_write_h(chandle mem, int addr, int data, byte wmask);
 
+    chandle mem;
+
+    // Byte and halfword accesses use their lanes of the aligned word; a
+    // halfword never straddles two words (address bit 0 is ignored)
     wire [1:0] byte_offset = address[1:0];
 
     initial begin
-        mem_init("/Users/sayat/Documents/GitHub/bootcamp_rv5/imem.hex");
+        // "" loads imem.hex from the simulator's working directory
+        mem = mem_attach("");
     end
 
     always_comb begin
         read_data = 32'b0; // Default read data
         if (read_enable) begin
             logic [31:0] word;
-            word = mem_read(address);
+            logic [7:0] byte_data;
+            logic [15:0] half_data;
+            word = mem_read_h(mem, address);
+            byte_data = word[8 * byte_offset +: 8];
+            half_data = word[16 * byte_offset[1] +: 16];
             case (funct3)
-                3'b010: begin // LW - load word
-                    read_data = word;
-                end
-                3'b100: begin // LBU - load byte unsigned
-                    case (byte_offset)
-                        2'b00: read_data = {24'b0, word[7:0]};
-                        2'b01: read_data = {24'b0, word[15:8]};
-                        2'b10: read_data = {24'b0, word[23:16]};
-                        2'b11: read_data = {24'b0, word[31:24]};
-                    endcase
-                end
+                3'b000: read_data = {{24{byte_data[7]}}, byte_data};  // LB
+                3'b001: read_data = {{16{half_data[15]}}, half_data}; // LH
+                3'b010: read_data = word;                             // LW
+                3'b100: read_data = {24'b0, byte_data};               // LBU
+                3'b101: read_data = {16'b0, half_data};               // LHU
                 default: begin
                     read_data = 32'b0;
                 end
@@ -42,16 +50,26 @@ module ram (
         end
     end
 
+    always_comb begin
+        case (funct3[1:0])
+            2'b00: begin // SB
+                store_data = write_data << (8 * byte_offset);
+                store_mask = 4'b0001 << byte_offset;
+            end
+            2'b01: begin // SH
+                store_data = write_data << (16 * byte_offset[1]);
+                store_mask = 4'b0011 << (2 * byte_offset[1]);
+            end
+            default: begin // SW
+                store_data = write_data;
+                store_mask = 4'hF;
+            end
+        endcase
+    end
+
     always_ff @( posedge clk ) begin
-        if (w_write_enable) begin
-            mem_write(address, write_data, 8'hF);
-        end else if (b_write_enable) begin
-            case (byte_offset)
-                2'b00: mem_write(address, write_data, 8'h1);
-                2'b01: mem_write(address, write_data, 8'h2);
-                2'b10: mem_write(address, write_data, 8'h4);
-                2'b11: mem_write(address, write_data, 8'h8);
-            endcase
+        if (write_enable) begin
+            mem_write_h(mem, address, store_data, {4'b0, store_mask});
         end
     end
 endmodule
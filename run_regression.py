@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+"""
+Run core_tb over a manifest of program images in parallel
+Each test runs in its own core_tb process and working directory; the
+RESULT line core_tb prints last is collected into a JSON/CSV summary.
+
+Manifest format: one test per line, '#' comments and blank lines skipped
+    <image> [core_tb options...]
+e.g.
+    tests/progs/add.hex
+    tests/progs/loop.elf --cycles 500000 --golden-thread
+Image paths are relative to the manifest's directory.
+"""
+
+import argparse
+import csv
+import json
+import os
+import shlex
+import subprocess
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor, as_completed
+
+RESULT_FIELDS = ['status', 'cycles', 'matches', 'mismatches',
+                 'first_mismatch_cycle', 'first_mismatch_pc']
+SUMMARY_FIELDS = ['name', 'image'] + RESULT_FIELDS + ['seconds', 'log']
+
+def parse_manifest(filename):
+    """Return a list of tests: {'name', 'image', 'args'}"""
+    base = os.path.dirname(os.path.abspath(filename))
+    tests = []
+    seen = {}
+
+    with open(filename, 'r') as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            fields = shlex.split(line)
+            image = fields[0]
+            if not os.path.isabs(image):
+                image = os.path.join(base, image)
+
+            # Same image with different options (seeds, cycle counts) gets
+            # a numbered name
+            stem = os.path.splitext(os.path.basename(image))[0]
+            count = seen.get(stem, 0)
+            seen[stem] = count + 1
+            name = stem if count == 0 else f"{stem}.{count}"
+
+            tests.append({'name': name, 'image': image, 'args': fields[1:]})
+
+    return tests
+
+def parse_result(output):
+    """Extract the RESULT key=value fields from core_tb output"""
+    for line in reversed(output.splitlines()):
+        if line.startswith('RESULT '):
+            fields = dict(kv.split('=', 1) for kv in line.split()[1:] if '=' in kv)
+            result = {key: fields.get(key, '-') for key in RESULT_FIELDS}
+            for key in ('cycles', 'matches', 'mismatches', 'first_mismatch_cycle'):
+                if result[key].isdigit():
+                    result[key] = int(result[key])
+            return result
+    return None
+
+def run_test(test, tb, out_dir, extra_args, timeout):
+    """Run one test; returns its summary row"""
+    work_dir = os.path.join(out_dir, test['name'])
+    os.makedirs(work_dir, exist_ok=True)
+    log_path = os.path.join(work_dir, 'core_tb.log')
+
+    cmd = [tb, '--image', test['image']] + extra_args + test['args']
+    start = time.monotonic()
+    try:
+        proc = subprocess.run(cmd, cwd=work_dir, stdout=subprocess.PIPE,
+                              stderr=subprocess.STDOUT, text=True,
+                              errors='replace', timeout=timeout)
+        output = proc.stdout
+        result = parse_result(output)
+        if result is None:
+            result = {key: '-' for key in RESULT_FIELDS}
+            result['status'] = f"error (exit {proc.returncode})"
+    except subprocess.TimeoutExpired as e:
+        output = e.stdout or ''
+        if isinstance(output, bytes):
+            output = output.decode(errors='replace')
+        result = {key: '-' for key in RESULT_FIELDS}
+        result['status'] = 'timeout'
+    elapsed = time.monotonic() - start
+
+    with open(log_path, 'w') as f:
+        f.write(' '.join(shlex.quote(c) for c in cmd) + '\n')
+        f.write(output)
+
+    row = {'name': test['name'], 'image': test['image']}
+    row.update(result)
+    row['seconds'] = round(elapsed, 3)
+    row['log'] = log_path
+    return row
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('manifest', help='test manifest')
+    parser.add_argument('--tb', default='obj_dir/Vcore', help='core_tb executable (default obj_dir/Vcore)')
+    parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count() or 1,
+                        help='parallel workers (default: all cores)')
+    parser.add_argument('--out', default='regression_out', help='per-test work/log directory')
+    parser.add_argument('--json', help='write summary as JSON')
+    parser.add_argument('--csv', help='write summary as CSV')
+    parser.add_argument('--timeout', type=float, default=None, help='per-test timeout in seconds')
+    parser.epilog = 'Options after -- are passed to every core_tb run.'
+
+    # Everything after "--" goes to core_tb
+    argv = sys.argv[1:]
+    extra_args = []
+    if '--' in argv:
+        split = argv.index('--')
+        argv, extra_args = argv[:split], argv[split + 1:]
+    args = parser.parse_args(argv)
+
+    tb = os.path.abspath(args.tb)
+    if not os.access(tb, os.X_OK):
+        print(f"Error: testbench {args.tb} not found or not executable")
+        sys.exit(2)
+
+    tests = parse_manifest(args.manifest)
+    if not tests:
+        print("Error: manifest has no tests")
+        sys.exit(2)
+    out_dir = os.path.abspath(args.out)
+
+    print(f"Running {len(tests)} tests on {args.jobs} workers")
+    rows = []
+    with ThreadPoolExecutor(max_workers=max(1, args.jobs)) as pool:
+        futures = [pool.submit(run_test, t, tb, out_dir, extra_args, args.timeout) for t in tests]
+        for future in as_completed(futures):
+            row = future.result()
+            rows.append(row)
+            mark = "✅" if row['status'] == 'pass' else "❌"
+            detail = f"{row['cycles']} cycles"
+            if row['status'] == 'fail':
+                detail += (f", first mismatch at cycle {row['first_mismatch_cycle']}"
+                           f" PC={row['first_mismatch_pc']}")
+            print(f"{mark} {row['name']}: {row['status']} ({detail}, {row['seconds']}s)")
+
+    # Report in manifest order
+    order = {t['name']: i for i, t in enumerate(tests)}
+    rows.sort(key=lambda r: order[r['name']])
+
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(rows, f, indent=2)
+    if args.csv:
+        with open(args.csv, 'w', newline='') as f:
+            writer = csv.DictWriter(f, fieldnames=SUMMARY_FIELDS)
+            writer.writeheader()
+            writer.writerows(rows)
+
+    passed = sum(1 for r in rows if r['status'] == 'pass')
+    print("=" * 80)
+    print(f"{passed}/{len(rows)} tests passed")
+    sys.exit(0 if passed == len(rows) else 1)
+
+if __name__ == '__main__':
+    main()
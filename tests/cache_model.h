@@ -0,0 +1,145 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Cache geometry and timing, as the parameters of rtl/cache.sv
+struct CacheConfig {
+    uint32_t size_bytes;
+    uint32_t ways;
+    uint32_t line_bytes;
+    bool write_back;            // false: write-through, no write-allocate
+    uint32_t miss_latency;      // cycles to fill a line (and to write one back)
+
+    // What is wrong with the geometry, or nullptr if it is usable; the
+    // same checks as rtl/cache.sv's elaboration-time assertion
+    const char* error() const {
+        if (!ways) return "ways must be at least 1";
+        if (!pow2(line_bytes)) return "line size must be a power of two";
+        if (size_bytes < ways * line_bytes) return "size must hold at least ways * line bytes";
+        uint32_t sets = size_bytes / (ways * line_bytes);
+        if (!pow2(sets) || sets * ways * line_bytes != size_bytes) {
+            return "size / (ways * line) must be a power of two";
+        }
+        return nullptr;
+    }
+
+private:
+    static bool pow2(uint32_t v) { return v && !(v & (v - 1)); }
+};
+
+// Functional model of rtl/cache.sv: the same lookup, LRU replacement and
+// write policy, so for the same access stream it reports the same hits,
+// misses and write-backs as the RTL's counters, and the stall cycles the
+// core spends waiting on it. Like the RTL it holds tags only; data lives
+// in the model's Memory.
+class CacheModel {
+public:
+    explicit CacheModel(const CacheConfig& cfg) : cfg(cfg) {
+        sets = cfg.size_bytes / (cfg.ways * cfg.line_bytes);
+        offset_bits = log2(cfg.line_bytes);
+        set_bits = log2(sets);
+        lines.resize(sets * cfg.ways);
+        reset();
+    }
+
+    // Cold cache, counters cleared
+    void reset() {
+        for (uint32_t i = 0; i < lines.size(); i++) {
+            lines[i].valid = false;
+            lines[i].dirty = false;
+            lines[i].tag = 0;
+            lines[i].age = i % cfg.ways;
+        }
+        hit_count = 0;
+        miss_count = 0;
+        writeback_count = 0;
+        stall_count = 0;
+    }
+
+    // One access; returns true on a hit
+    bool access(uint32_t addr, bool write) {
+        Line* set = &lines[((addr >> offset_bits) & (sets - 1)) * cfg.ways];
+        uint32_t tag = addr >> (offset_bits + set_bits);
+        for (uint32_t w = 0; w < cfg.ways; w++) {
+            if (set[w].valid && set[w].tag == tag) {
+                hit_count++;
+                touch(set, w);
+                if (cfg.write_back && write) set[w].dirty = true;
+                return true;
+            }
+        }
+        miss_count++;
+        if (!cfg.write_back && write) return false;
+
+        uint32_t victim = cfg.ways;
+        for (uint32_t w = 0; w < cfg.ways && victim == cfg.ways; w++) {
+            if (!set[w].valid) victim = w;
+        }
+        for (uint32_t w = 0; w < cfg.ways && victim == cfg.ways; w++) {
+            if (set[w].age == cfg.ways - 1) victim = w;
+        }
+        stall_count += cfg.miss_latency;
+        if (set[victim].valid && set[victim].dirty) {
+            writeback_count++;
+            stall_count += cfg.miss_latency;
+        }
+        set[victim].valid = true;
+        set[victim].dirty = cfg.write_back && write;
+        set[victim].tag = tag;
+        touch(set, victim);
+        return false;
+    }
+
+    const CacheConfig& config() const { return cfg; }
+    uint64_t hits() const { return hit_count; }
+    uint64_t misses() const { return miss_count; }
+    uint64_t writebacks() const { return writeback_count; }
+    // Cycles a core waits on this cache: miss_latency per fill, plus as
+    // much again per write-back
+    uint64_t stall_cycles() const { return stall_count; }
+
+    void print(const char* name) const {
+        uint64_t n = hit_count + miss_count;
+        std::printf("%s: %u B, %u-way, %u B lines, %s, miss latency %u: "
+                    "%llu hits, %llu misses (%.2f%% hit rate), %llu write-backs, "
+                    "%llu stall cycles\n",
+                    name, cfg.size_bytes, cfg.ways, cfg.line_bytes,
+                    cfg.write_back ? "write-back" : "write-through", cfg.miss_latency,
+                    ull(hit_count), ull(miss_count), n ? 100.0 * hit_count / n : 0.0,
+                    ull(writeback_count), ull(stall_count));
+    }
+
+private:
+    struct Line {
+        bool valid;
+        bool dirty;
+        uint32_t tag;
+        uint32_t age;       // 0 = most recently used within its set
+    };
+
+    CacheConfig cfg;
+    uint32_t sets;
+    uint32_t offset_bits;
+    uint32_t set_bits;
+    std::vector<Line> lines;    // sets * ways, one set after another
+    uint64_t hit_count;
+    uint64_t miss_count;
+    uint64_t writeback_count;
+    uint64_t stall_count;
+
+    void touch(Line* set, uint32_t way) {
+        for (uint32_t w = 0; w < cfg.ways; w++) {
+            if (set[w].age < set[way].age) set[w].age++;
+        }
+        set[way].age = 0;
+    }
+
+    static uint32_t log2(uint32_t v) {
+        uint32_t n = 0;
+        while ((1u << n) < v) n++;
+        return n;
+    }
+
+    static unsigned long long ull(uint64_t v) { return static_cast<unsigned long long>(v); }
+};
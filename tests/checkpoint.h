@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include "memory.h"
+
+// Architectural state snapshot, enough to resume a run on the golden
+// model or to load it into the RTL through core.sv's state_load port.
+// File layout (host byte order, little-endian on every supported host):
+//   char[8]  "RV5CKPT1"
+//   u64      instructions retired when the snapshot was taken
+//   u32      pc
+//   u32[16]  gpr
+//   memory pages as written by Memory::save_pages()
+struct Checkpoint {
+    uint64_t instret;
+    uint32_t pc;
+    uint32_t gpr[16];
+};
+
+static const char CHECKPOINT_MAGIC[8] = {'R', 'V', '5', 'C', 'K', 'P', 'T', '1'};
+
+inline bool checkpoint_save(const char* path, const Checkpoint& cp, const Memory& mem) {
+    FILE* fp = std::fopen(path, "wb");
+    if (!fp) {
+        std::perror("checkpoint_save fopen");
+        return false;
+    }
+    bool ok = std::fwrite(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC), 1, fp) == 1 &&
+              std::fwrite(&cp.instret, sizeof(cp.instret), 1, fp) == 1 &&
+              std::fwrite(&cp.pc, sizeof(cp.pc), 1, fp) == 1 &&
+              std::fwrite(cp.gpr, sizeof(cp.gpr), 1, fp) == 1 &&
+              mem.save_pages(fp);
+    if (std::fclose(fp) != 0) ok = false;
+    if (!ok) std::fprintf(stderr, "checkpoint_save: error writing %s\n", path);
+    return ok;
+}
+
+inline bool checkpoint_load(const char* path, Checkpoint& cp, Memory& mem) {
+    FILE* fp = std::fopen(path, "rb");
+    if (!fp) {
+        std::perror("checkpoint_load fopen");
+        return false;
+    }
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    bool ok = std::fread(magic, sizeof(magic), 1, fp) == 1 &&
+              std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) == 0 &&
+              std::fread(&cp.instret, sizeof(cp.instret), 1, fp) == 1 &&
+              std::fread(&cp.pc, sizeof(cp.pc), 1, fp) == 1 &&
+              std::fread(cp.gpr, sizeof(cp.gpr), 1, fp) == 1 &&
+              mem.load_pages(fp);
+    std::fclose(fp);
+    if (!ok) std::fprintf(stderr, "checkpoint_load: %s is not a valid checkpoint\n", path);
+    return ok;
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "rv32_decoder.h"
+
+// Retired-instruction classes are the decoder's ops (RV32_OTHER collects
+// unsupported encodings, executed as NOP). rtl/perf_counters.sv counts
+// the same classes in the same order, so the two reports line up index
+// by index.
+typedef Rv32Op InstrClass;
+static const int NUM_INSTR_CLASSES = RV32_NUM_OPS;
+static const char* const* const INSTR_CLASS_NAMES = RV32_OP_NAMES;
+
+// Workload profile collected by the golden model. Class counts are always
+// kept (one increment per instruction); the PC and memory histograms cost
+// a hash lookup per event and are only kept when enabled.
+class InstrProfile {
+public:
+    // Memory histogram granularity: 64-byte blocks
+    static const uint32_t MEM_BLOCK_BITS = 6;
+
+    InstrProfile() : histograms(false) {
+        clear();
+    }
+
+    void enable_histograms() { histograms = true; }
+
+    void clear() {
+        for (int i = 0; i < NUM_INSTR_CLASSES; i++) {
+            class_counts[i] = 0;
+        }
+        pc_hist.clear();
+        mem_hist.clear();
+    }
+
+    void retire(InstrClass cls, uint32_t pc) {
+        class_counts[cls]++;
+        if (histograms) pc_hist[pc]++;
+    }
+
+    void mem_read(uint32_t addr) {
+        if (histograms) mem_hist[addr >> MEM_BLOCK_BITS].reads++;
+    }
+
+    void mem_write(uint32_t addr) {
+        if (histograms) mem_hist[addr >> MEM_BLOCK_BITS].writes++;
+    }
+
+    uint64_t count(InstrClass cls) const { return class_counts[cls]; }
+
+    uint64_t total() const {
+        uint64_t n = 0;
+        for (int i = 0; i < NUM_INSTR_CLASSES; i++) {
+            n += class_counts[i];
+        }
+        return n;
+    }
+
+    // JSON report. rtl_counts (NUM_INSTR_CLASSES entries, may be null)
+    // are the core's own counters, for side-by-side comparison.
+    // Histograms are sorted hottest first.
+    bool write_json(const char* path, const uint64_t* rtl_counts) const {
+        FILE* fp = std::fopen(path, "w");
+        if (!fp) {
+            std::perror("InstrProfile fopen");
+            return false;
+        }
+        std::fprintf(fp, "{\n  \"instret\": %llu,\n", ull(total()));
+        write_classes(fp, "classes", class_counts);
+        if (rtl_counts) write_classes(fp, "rtl_classes", rtl_counts);
+
+        std::vector<std::pair<uint32_t, uint64_t>> pcs(pc_hist.begin(), pc_hist.end());
+        std::sort(pcs.begin(), pcs.end(), [](const std::pair<uint32_t, uint64_t>& a,
+                                             const std::pair<uint32_t, uint64_t>& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+        std::fprintf(fp, "  \"pc_histogram\": [");
+        for (size_t i = 0; i < pcs.size(); i++) {
+            std::fprintf(fp, "%s\n    {\"pc\": \"0x%08x\", \"count\": %llu}", i ? "," : "",
+                         pcs[i].first, ull(pcs[i].second));
+        }
+        std::fprintf(fp, "%s],\n", pcs.empty() ? "" : "\n  ");
+
+        std::vector<std::pair<uint32_t, MemBlock>> blocks(mem_hist.begin(), mem_hist.end());
+        std::sort(blocks.begin(), blocks.end(), [](const std::pair<uint32_t, MemBlock>& a,
+                                                   const std::pair<uint32_t, MemBlock>& b) {
+            uint64_t na = a.second.reads + a.second.writes;
+            uint64_t nb = b.second.reads + b.second.writes;
+            return na != nb ? na > nb : a.first < b.first;
+        });
+        std::fprintf(fp, "  \"mem_block_bytes\": %u,\n", 1u << MEM_BLOCK_BITS);
+        std::fprintf(fp, "  \"mem_footprint_bytes\": %llu,\n",
+                     ull(static_cast<uint64_t>(blocks.size()) << MEM_BLOCK_BITS));
+        std::fprintf(fp, "  \"mem_histogram\": [");
+        for (size_t i = 0; i < blocks.size(); i++) {
+            std::fprintf(fp, "%s\n    {\"addr\": \"0x%08x\", \"reads\": %llu, \"writes\": %llu}",
+                         i ? "," : "", blocks[i].first << MEM_BLOCK_BITS,
+                         ull(blocks[i].second.reads), ull(blocks[i].second.writes));
+        }
+        std::fprintf(fp, "%s]\n}\n", blocks.empty() ? "" : "\n  ");
+        return std::fclose(fp) == 0;
+    }
+
+private:
+    struct MemBlock {
+        uint64_t reads = 0;
+        uint64_t writes = 0;
+    };
+
+    uint64_t class_counts[NUM_INSTR_CLASSES];
+    bool histograms;
+    std::unordered_map<uint32_t, uint64_t> pc_hist;
+    std::unordered_map<uint32_t, MemBlock> mem_hist;
+
+    static unsigned long long ull(uint64_t v) { return static_cast<unsigned long long>(v); }
+
+    static void write_classes(FILE* fp, const char* key, const uint64_t* counts) {
+        std::fprintf(fp, "  \"%s\": {", key);
+        for (int i = 0; i < NUM_INSTR_CLASSES; i++) {
+            std::fprintf(fp, "%s\"%s\": %llu", i ? ", " : "", INSTR_CLASS_NAMES[i], ull(counts[i]));
+        }
+        std::fprintf(fp, "},\n");
+    }
+};
@@ -1,37 +1,173 @@
 #include <verilated.h>
-#include <verilated_vcd_c.h>
 #include <iostream>
 #include <fstream>
 #include <cstring>
+#include <cstdio>
 #include <iomanip>
+#include <chrono>
+#include <memory>
+#include <thread>
 #include "Vcore.h"
 #include "memory.h"
+#include "retire_queue.h"
+#include "core_trace.h"
+#include "checkpoint.h"
+#include "core_profile.h"
+#include "rv32_decoder.h"
+#include "cache_model.h"
+#include "mem_trace.h"
+#include "retire_trace.h"
+
+// Scope of the top module, for binding fetch/ram to their memory.
+// build.sh CORE=pipe builds the pipelined core as Vcore with -DCORE_PIPE.
+#ifdef CORE_PIPE
+#define CORE_SCOPE "TOP.core_pipe"
+#else
+#define CORE_SCOPE "TOP.core"
+#endif
+
+// Cache parameters the RTL was built with. build.sh passes its cache
+// settings both to Verilator (-G) and here (-D); the defaults are
+// core.sv's.
+#ifndef ICACHE_SIZE
+#define ICACHE_SIZE 4096
+#endif
+#ifndef ICACHE_WAYS
+#define ICACHE_WAYS 2
+#endif
+#ifndef ICACHE_LINE
+#define ICACHE_LINE 16
+#endif
+#ifndef DCACHE_SIZE
+#define DCACHE_SIZE 4096
+#endif
+#ifndef DCACHE_WAYS
+#define DCACHE_WAYS 2
+#endif
+#ifndef DCACHE_LINE
+#define DCACHE_LINE 16
+#endif
+#ifndef DCACHE_WRITE_BACK
+#define DCACHE_WRITE_BACK 1
+#endif
+#ifndef MISS_LATENCY
+#define MISS_LATENCY 10
+#endif
+static const CacheConfig ICACHE_CONFIG = {ICACHE_SIZE, ICACHE_WAYS, ICACHE_LINE, true,
+                                          MISS_LATENCY};
+static const CacheConfig DCACHE_CONFIG = {DCACHE_SIZE, DCACHE_WAYS, DCACHE_LINE,
+                                          DCACHE_WRITE_BACK != 0, MISS_LATENCY};
 
 using namespace std;
 
+// What one retired instruction did to architectural state
+struct RetireRecord {
+    uint32_t pc;        // address of the retired instruction
+    uint32_t instr;
+    InstrClass cls;     // profile class
+    uint32_t next_pc;
+    bool we;            // register write (never reported for x0)
+    uint8_t rd;
+    uint32_t wdata;
+    bool mem_we;        // store: bytes of mem_data selected by mem_mask
+    uint8_t mem_mask;
+    uint32_t mem_addr;
+    uint32_t mem_data;
+    bool mem_re;        // load from load_addr
+    uint32_t load_addr;
+};
+
 // Golden Model Class
 class RV32GoldenModel {
 private:
+    // Pre-decoded instruction: handler plus operand fields, tagged with
+    // the PC it was decoded from
+    struct DecodedInstr;
+    typedef uint32_t (*ExecFn)(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc);
+    struct DecodedInstr {
+        ExecFn exec;        // nullptr = slot empty
+        uint32_t tag;       // PC of the decoded instruction
+        uint32_t raw;       // instruction word
+        uint8_t rd, rs1, rs2;
+        InstrClass cls;     // profile class
+        int32_t imm;        // immediate in the op's format (see rv32_decoder.h)
+    };
+    
+    // Direct-mapped decode cache indexed by PC. Code and data share one
+    // memory here, so stores drop any entry they overwrite.
+    static const uint32_t DECODE_CACHE_SIZE = 4096;
+    
     uint32_t gpr[16];
     uint32_t pc;
-    uint32_t opcode, rd, rs1, rs2, funct3, funct7;
-    int32_t imm_i;
-    uint32_t imm_u;
+    uint64_t instret;       // instructions retired since reset
+    Memory mem;             // private copy, independent of the RTL's
+    InstrProfile prof;
+    // Models of the RTL's caches, fed the same fetches, loads and stores
+    CacheModel icache_sim;
+    CacheModel dcache_sim;
+    MemTraceWriter* mem_trace;  // every access is also written here, if set
+    DecodedInstr icache[DECODE_CACHE_SIZE];
+    DecodedInstr uncached;
+    RetireRecord retired;
     
-    void decode(uint32_t instr) {
-        opcode = instr & 0x7F;
-        rd = (instr >> 7) & 0x1F;
-        funct3 = (instr >> 12) & 0x07;
-        rs1 = (instr >> 15) & 0x1F;
-        rs2 = (instr >> 20) & 0x1F;
-        funct7 = (instr >> 25) & 0x7F;
-        imm_i = static_cast<int32_t>(instr) >> 20;
-        imm_u = instr >> 12;
+    void flush_icache() {
+        for (uint32_t i = 0; i < DECODE_CACHE_SIZE; i++) {
+            icache[i].exec = nullptr;
+        }
+    }
+    
+    void invalidate_icache(uint32_t byte_addr) {
+        DecodedInstr& d = icache[(byte_addr >> 2) & (DECODE_CACHE_SIZE - 1)];
+        if (d.exec && (d.tag & ~0x3u) == (byte_addr & ~0x3u)) {
+            d.exec = nullptr;
+        }
+    }
+    
+    // Look up the decoded instruction at addr, decoding it on a miss.
+    // PCs in the clamped top word all alias one address; they bypass the
+    // cache so invalidation stays a single-slot check.
+    const DecodedInstr& fetch(uint32_t addr) {
+        if (addr >= MEM_SIZE - 4) {
+            uncached = decode(mem.read(addr));
+            return uncached;
+        }
+        DecodedInstr& d = icache[(addr >> 2) & (DECODE_CACHE_SIZE - 1)];
+        if (!d.exec || d.tag != addr) {
+            d = decode(mem.read(addr));
+            d.tag = addr;
+        }
+        return d;
+    }
+    
+    static DecodedInstr decode(uint32_t instr) {
+        // Handler per decoder op, in Rv32Op order
+        static const ExecFn handlers[RV32_NUM_OPS] = {
+            exec_add, exec_addi, exec_lui, exec_lw, exec_lbu, exec_sw, exec_sb, exec_jalr,
+            exec_sub, exec_sll, exec_slt, exec_sltu, exec_xor, exec_srl, exec_sra, exec_or,
+            exec_and, exec_slti, exec_sltiu, exec_xori, exec_ori, exec_andi, exec_slli,
+            exec_srli, exec_srai, exec_auipc, exec_jal, exec_beq, exec_bne, exec_blt,
+            exec_bge, exec_bltu, exec_bgeu, exec_lb, exec_lh, exec_lhu, exec_sh, exec_nop
+        };
+        Rv32Decoded r = rv32_decode(instr);
+        
+        DecodedInstr d;
+        d.exec = handlers[r.op];
+        d.tag = 0;
+        d.raw = instr;
+        d.rd = r.rd;
+        d.rs1 = r.rs1;
+        d.rs2 = r.rs2;
+        d.cls = static_cast<InstrClass>(r.op);
+        d.imm = r.imm;
+        return d;
     }
     
     void write_gpr(uint32_t index, uint32_t value) {
         if ((index & 0xF) != 0) {
             gpr[index & 0xF] = value;
+            retired.we = true;
+            retired.rd = index & 0xF;
+            retired.wdata = value;
         }
     }
     
@@ -40,195 +176,735 @@ private:
     }
     
     uint32_t load_word(uint32_t byte_addr) {
-        return static_cast<uint32_t>(mem_read(static_cast<int>(byte_addr)));
+        prof.mem_read(byte_addr);
+        dcache_sim.access(byte_addr, false);
+        if (mem_trace) mem_trace->load(byte_addr, 4);
+        retired.mem_re = true;
+        retired.load_addr = byte_addr;
+        return mem.read(byte_addr);
     }
     
+    // Byte and halfword accesses use their lane of the aligned word, as
+    // ram.sv does; a halfword never straddles two words (address bit 0
+    // is ignored)
     uint32_t load_byte_unsigned(uint32_t byte_addr) {
-        uint32_t word = static_cast<uint32_t>(mem_read(static_cast<int>(byte_addr)));
+        prof.mem_read(byte_addr);
+        dcache_sim.access(byte_addr, false);
+        if (mem_trace) mem_trace->load(byte_addr, 1);
+        retired.mem_re = true;
+        retired.load_addr = byte_addr;
+        uint32_t word = mem.read(byte_addr);
         uint32_t byte_offset = byte_addr & 0x3;
         return (word >> (byte_offset * 8)) & 0xFF;
     }
     
+    uint32_t load_half_unsigned(uint32_t byte_addr) {
+        prof.mem_read(byte_addr);
+        dcache_sim.access(byte_addr, false);
+        if (mem_trace) mem_trace->load(byte_addr, 2);
+        retired.mem_re = true;
+        retired.load_addr = byte_addr;
+        uint32_t word = mem.read(byte_addr);
+        return (word >> ((byte_addr & 0x2) * 8)) & 0xFFFF;
+    }
+    
+    // value is already shifted into the lanes selected by mask
+    void store(uint32_t byte_addr, uint32_t value, uint8_t mask) {
+        prof.mem_write(byte_addr);
+        dcache_sim.access(byte_addr, true);
+        if (mem_trace) mem_trace->store(byte_addr, mask == 0xF ? 4 : (mask & (mask - 1)) ? 2 : 1);
+        mem.write(byte_addr, value, mask);
+        invalidate_icache(byte_addr);
+        retired.mem_we = true;
+        retired.mem_mask = mask;
+        retired.mem_addr = byte_addr;
+        retired.mem_data = value;
+    }
+    
     void store_word(uint32_t byte_addr, uint32_t value) {
-        mem_write(static_cast<int>(byte_addr), static_cast<int>(value), 0xF);
+        store(byte_addr, value, 0xF);
+    }
+    
+    void store_half(uint32_t byte_addr, uint32_t value) {
+        uint32_t half_offset = byte_addr & 0x2;
+        store(byte_addr, value << (half_offset * 8), 0x3 << half_offset);
     }
     
     void store_byte(uint32_t byte_addr, uint32_t value) {
         uint32_t byte_offset = byte_addr & 0x3;
-        unsigned char mask = 1u << byte_offset;
-        mem_write(static_cast<int>(byte_addr), static_cast<int>(value), mask);
+        store(byte_addr, value << (byte_offset * 8), 1u << byte_offset);
+    }
+    
+    // Instruction handlers: execute one decoded instruction, return next PC
+    static uint32_t exec_nop(RV32GoldenModel&, const DecodedInstr&, uint32_t pc) {
+        return pc + 4;
+    }
+    static uint32_t exec_add(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) + m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    static uint32_t exec_sub(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) - m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    static uint32_t exec_sll(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) << (m.read_gpr(d.rs2) & 0x1F));
+        return pc + 4;
+    }
+    static uint32_t exec_slt(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, static_cast<int32_t>(m.read_gpr(d.rs1)) <
+                          static_cast<int32_t>(m.read_gpr(d.rs2)));
+        return pc + 4;
+    }
+    static uint32_t exec_sltu(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) < m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    static uint32_t exec_xor(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) ^ m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    static uint32_t exec_srl(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) >> (m.read_gpr(d.rs2) & 0x1F));
+        return pc + 4;
+    }
+    static uint32_t exec_sra(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, static_cast<int32_t>(m.read_gpr(d.rs1)) >> (m.read_gpr(d.rs2) & 0x1F));
+        return pc + 4;
+    }
+    static uint32_t exec_or(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) | m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    static uint32_t exec_and(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) & m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    static uint32_t exec_addi(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) + d.imm);
+        return pc + 4;
+    }
+    static uint32_t exec_slti(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, static_cast<int32_t>(m.read_gpr(d.rs1)) < d.imm);
+        return pc + 4;
+    }
+    static uint32_t exec_sltiu(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) < static_cast<uint32_t>(d.imm));
+        return pc + 4;
+    }
+    static uint32_t exec_xori(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) ^ d.imm);
+        return pc + 4;
+    }
+    static uint32_t exec_ori(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) | d.imm);
+        return pc + 4;
+    }
+    static uint32_t exec_andi(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) & d.imm);
+        return pc + 4;
+    }
+    static uint32_t exec_slli(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) << d.imm);
+        return pc + 4;
+    }
+    static uint32_t exec_srli(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.read_gpr(d.rs1) >> d.imm);
+        return pc + 4;
+    }
+    static uint32_t exec_srai(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, static_cast<int32_t>(m.read_gpr(d.rs1)) >> d.imm);
+        return pc + 4;
+    }
+    static uint32_t exec_lui(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, d.imm);
+        return pc + 4;
+    }
+    static uint32_t exec_auipc(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, pc + d.imm);
+        return pc + 4;
+    }
+    static uint32_t exec_lw(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.load_word(m.read_gpr(d.rs1) + d.imm));
+        return pc + 4;
+    }
+    static uint32_t exec_lh(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, static_cast<int16_t>(m.load_half_unsigned(m.read_gpr(d.rs1) + d.imm)));
+        return pc + 4;
+    }
+    static uint32_t exec_lhu(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.load_half_unsigned(m.read_gpr(d.rs1) + d.imm));
+        return pc + 4;
+    }
+    static uint32_t exec_lb(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, static_cast<int8_t>(m.load_byte_unsigned(m.read_gpr(d.rs1) + d.imm)));
+        return pc + 4;
+    }
+    static uint32_t exec_lbu(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, m.load_byte_unsigned(m.read_gpr(d.rs1) + d.imm));
+        return pc + 4;
+    }
+    static uint32_t exec_sw(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.store_word(m.read_gpr(d.rs1) + d.imm, m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    static uint32_t exec_sh(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.store_half(m.read_gpr(d.rs1) + d.imm, m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    static uint32_t exec_sb(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.store_byte(m.read_gpr(d.rs1) + d.imm, m.read_gpr(d.rs2));
+        return pc + 4;
+    }
+    static uint32_t exec_jal(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        m.write_gpr(d.rd, pc + 4);
+        return pc + d.imm;
+    }
+    static uint32_t exec_jalr(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        uint32_t target = (m.read_gpr(d.rs1) + d.imm) & ~1u;
+        m.write_gpr(d.rd, pc + 4);
+        return target;
+    }
+    static uint32_t exec_beq(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        return m.read_gpr(d.rs1) == m.read_gpr(d.rs2) ? pc + d.imm : pc + 4;
+    }
+    static uint32_t exec_bne(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        return m.read_gpr(d.rs1) != m.read_gpr(d.rs2) ? pc + d.imm : pc + 4;
+    }
+    static uint32_t exec_blt(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        return static_cast<int32_t>(m.read_gpr(d.rs1)) < static_cast<int32_t>(m.read_gpr(d.rs2))
+               ? pc + d.imm : pc + 4;
+    }
+    static uint32_t exec_bge(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        return static_cast<int32_t>(m.read_gpr(d.rs1)) >= static_cast<int32_t>(m.read_gpr(d.rs2))
+               ? pc + d.imm : pc + 4;
+    }
+    static uint32_t exec_bltu(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        return m.read_gpr(d.rs1) < m.read_gpr(d.rs2) ? pc + d.imm : pc + 4;
+    }
+    static uint32_t exec_bgeu(RV32GoldenModel& m, const DecodedInstr& d, uint32_t pc) {
+        return m.read_gpr(d.rs1) >= m.read_gpr(d.rs2) ? pc + d.imm : pc + 4;
     }
 
 public:
-    RV32GoldenModel() {
+    RV32GoldenModel()
+        : icache_sim(ICACHE_CONFIG), dcache_sim(DCACHE_CONFIG), mem_trace(nullptr) {
         reset();
     }
     
     void reset() {
         memset(gpr, 0, sizeof(gpr));
         pc = 0;
+        instret = 0;
+        flush_icache();
+        reset_caches();
+    }
+    
+    // Cold caches and cleared counters, as the RTL's after reset
+    void reset_caches() {
+        icache_sim.reset();
+        dcache_sim.reset();
     }
     
     bool load_memory(const string& filename) {
-        mem_init(filename.c_str());
+        flush_icache();
+        return mem.load(filename.c_str());
+    }
+    
+    bool save_checkpoint(const string& path) const {
+        Checkpoint cp;
+        cp.instret = instret;
+        cp.pc = pc;
+        memcpy(cp.gpr, gpr, sizeof(gpr));
+        return checkpoint_save(path.c_str(), cp, mem);
+    }
+    
+    bool restore_checkpoint(const string& path) {
+        Checkpoint cp;
+        flush_icache();
+        if (!checkpoint_load(path.c_str(), cp, mem)) return false;
+        instret = cp.instret;
+        pc = cp.pc;
+        memcpy(gpr, cp.gpr, sizeof(gpr));
+        gpr[0] = 0;
         return true;
     }
     
-    void step() {
-        uint32_t instr = static_cast<uint32_t>(mem_read(static_cast<int>(pc)));
-        uint32_t current_pc = pc;
-        decode(instr);
-        
-        uint32_t next_pc = pc + 4;
-        uint32_t alu_result = 0;
-        bool branch_taken = false;
-        
-        switch (opcode) {
-            case 0b0110011: // ADD
-                if (funct7 == 0x00 && funct3 == 0x0) {
-                    alu_result = read_gpr(rs1) + read_gpr(rs2);
-                    write_gpr(rd, alu_result);
-                }
-                break;
-            case 0b0010011: // ADDI
-                if (funct3 == 0x0) {
-                    alu_result = read_gpr(rs1) + imm_i;
-                    write_gpr(rd, alu_result);
-                }
-                break;
-            case 0b0110111: // LUI
-                alu_result = imm_u << 12;
-                write_gpr(rd, alu_result);
-                break;
-            case 0b0000011: // Load
-                alu_result = read_gpr(rs1) + imm_i;
-                if (funct3 == 0b010) {
-                    write_gpr(rd, load_word(alu_result));
-                } else if (funct3 == 0b100) {
-                    write_gpr(rd, load_byte_unsigned(alu_result));
-                }
-                break;
-            case 0b0100011: // Store
-                alu_result = read_gpr(rs1) + imm_i;
-                if (funct3 == 0b010) {
-                    store_word(alu_result, read_gpr(rs2));
-                } else if (funct3 == 0b000) {
-                    store_byte(alu_result, read_gpr(rs2));
-                }
-                break;
-            case 0b1100111: // JALR
-                if (funct3 == 0x0) {
-                    alu_result = (read_gpr(rs1) + imm_i) & ~1;
-                    write_gpr(rd, current_pc + 4);
-                    next_pc = alu_result;
-                    branch_taken = true;
-                }
-                break;
-            default:
-                break;
-        }
-        pc = next_pc;
+    // Execute one instruction and report what it changed
+    const RetireRecord& step() {
+        const DecodedInstr& d = fetch(pc);
+        retired.pc = pc;
+        retired.instr = d.raw;
+        retired.cls = d.cls;
+        retired.we = false;
+        retired.rd = 0;
+        retired.wdata = 0;
+        retired.mem_we = false;
+        retired.mem_mask = 0;
+        retired.mem_addr = 0;
+        retired.mem_data = 0;
+        retired.mem_re = false;
+        retired.load_addr = 0;
+        prof.retire(d.cls, pc);
+        icache_sim.access(pc, false);
+        if (mem_trace) mem_trace->fetch(pc);
+        pc = d.exec(*this, d, pc);
+        retired.next_pc = pc;
+        instret++;
+        return retired;
     }
     
     uint32_t get_gpr(int index) const { return gpr[index & 0xF]; }
     uint32_t get_pc() const { return pc; }
+    uint64_t get_instret() const { return instret; }
+    const Memory& memory() const { return mem; }
+    InstrProfile& profile() { return prof; }
+    const CacheModel& icache_model() const { return icache_sim; }
+    const CacheModel& dcache_model() const { return dcache_sim; }
+    void set_mem_trace(MemTraceWriter* trace) { mem_trace = trace; }
     
     // Get instruction at PC
     uint32_t get_instruction_at_pc() const {
-        return static_cast<uint32_t>(mem_read(static_cast<int>(pc)));
+        return mem.read(pc);
     }
     
-    // Decode and print instruction
+    // Instruction word and its disassembly
     static string decode_instruction(uint32_t instr) {
-        uint32_t opcode = instr & 0x7F;
-        uint32_t rd = (instr >> 7) & 0x1F;
-        uint32_t funct3 = (instr >> 12) & 0x07;
-        uint32_t rs1 = (instr >> 15) & 0x1F;
-        uint32_t rs2 = (instr >> 20) & 0x1F;
-        uint32_t funct7 = (instr >> 25) & 0x7F;
-        int32_t imm_i = static_cast<int32_t>(instr) >> 20;
-        uint32_t imm_u = instr >> 12;
-        
-        stringstream ss;
-        ss << "0x" << hex << setw(8) << setfill('0') << instr << " ";
-        
-        switch (opcode) {
-            case 0b0110011: // R-type
-                if (funct7 == 0x00 && funct3 == 0x0) {
-                    ss << "add x" << dec << rd << ", x" << rs1 << ", x" << rs2;
-                } else {
-                    ss << "UNKNOWN R-type";
-                }
-                break;
-            case 0b0010011: // I-type ALU
-                if (funct3 == 0x0) {
-                    ss << "addi x" << dec << rd << ", x" << rs1 << ", " << imm_i;
-                } else {
-                    ss << "UNKNOWN I-type ALU (funct3=" << funct3 << ")";
-                }
-                break;
-            case 0b0110111: // LUI
-                ss << "lui x" << dec << rd << ", 0x" << hex << imm_u;
-                break;
-            case 0b0000011: // Load
-                if (funct3 == 0b010) {
-                    ss << "lw x" << dec << rd << ", " << imm_i << "(x" << rs1 << ")";
-                } else if (funct3 == 0b100) {
-                    ss << "lbu x" << dec << rd << ", " << imm_i << "(x" << rs1 << ")";
-                } else {
-                    ss << "UNKNOWN Load (funct3=" << funct3 << ")";
-                }
-                break;
-            case 0b0100011: // Store
-                if (funct3 == 0b010) {
-                    ss << "sw x" << dec << rs2 << ", " << imm_i << "(x" << rs1 << ")";
-                } else if (funct3 == 0b000) {
-                    ss << "sb x" << dec << rs2 << ", " << imm_i << "(x" << rs1 << ")";
-                } else {
-                    ss << "UNKNOWN Store (funct3=" << funct3 << ")";
-                }
-                break;
-            case 0b1100111: // JALR
-                ss << "jalr x" << dec << rd << ", " << imm_i << "(x" << rs1 << ")";
-                break;
-            default:
-                ss << "UNSUPPORTED (opcode=" << hex << opcode << ")";
-                break;
-        }
-        
-        return ss.str();
+        char word[16];
+        snprintf(word, sizeof(word), "0x%08x ", instr);
+        return word + rv32_disasm(instr);
     }
 };
 
 // Clock tick helper
-void tick(Vcore* dut, VerilatedVcdC* tfp, vluint64_t& time) {
+void tick(Vcore* dut, CoreTracer<Vcore>& tracer, vluint64_t& time) {
     dut->clk = 0;
     dut->eval();
-    if (tfp) tfp->dump(time++);
+    tracer.dump(time++);
     
     dut->clk = 1;
     dut->eval();
-    if (tfp) tfp->dump(time++);
+    tracer.dump(time++);
+}
+
+// Golden architectural state as seen by the checker. It is rebuilt from
+// retirement records, so it is valid whether the model runs inline or
+// ahead on its own thread.
+struct GoldenState {
+    uint32_t pc;
+    uint32_t gpr[16];
+    
+    void apply(const RetireRecord& rec) {
+        pc = rec.next_pc;
+        if (rec.we) gpr[rec.rd & 0xF] = rec.wdata;
+    }
+};
+
+// Records in flight between the golden thread and the checker
+typedef RetireQueue<RetireRecord, 1 << 16> GoldenQueue;
+
+// Count a retirement in a profile, as the golden model does while it
+// steps; with --golden-thread the checker profiles only the records it
+// pops, not the golden model's run-ahead
+void profile_record(InstrProfile& prof, const RetireRecord& rec) {
+    prof.retire(rec.cls, rec.pc);
+    if (rec.mem_re) prof.mem_read(rec.load_addr);
+    if (rec.mem_we) prof.mem_write(rec.mem_addr);
+}
+
+// Expand a 4-bit byte mask to a 32-bit bit mask
+static inline uint32_t byte_mask(uint8_t mask) {
+    return ((mask & 0x1) ? 0x000000FFu : 0) | ((mask & 0x2) ? 0x0000FF00u : 0) |
+           ((mask & 0x4) ? 0x00FF0000u : 0) | ((mask & 0x8) ? 0xFF000000u : 0);
+}
+
+// Did RTL and golden model perform the same store (or both none)?
+bool store_matches(Vcore* dut, const RetireRecord& rec) {
+    if (dut->retire_store_out != rec.mem_we) return false;
+    if (!rec.mem_we) return true;
+    return (dut->retire_store_addr_out & ~0x3u) == (rec.mem_addr & ~0x3u) &&
+           dut->retire_store_mask_out == rec.mem_mask &&
+           ((dut->retire_store_data_out ^ rec.mem_data) & byte_mask(rec.mem_mask)) == 0;
+}
+
+// Print the full PC/register comparison between RTL and golden model
+void print_state_comparison(Vcore* dut, const GoldenState& golden) {
+    cout << "\nCurrent State Comparison:" << endl;
+    cout << "  PC:" << endl;
+    cout << "    RTL    = 0x" << hex << setw(8) << setfill('0') << dut->retire_next_pc_out << endl;
+    cout << "    Golden = 0x" << setw(8) << golden.pc << endl;
+    if (dut->retire_next_pc_out != golden.pc) {
+        cout << "    DIFF   = " << (dut->retire_next_pc_out > golden.pc ? "+" : "") 
+             << dec << (int32_t)(dut->retire_next_pc_out - golden.pc) << endl;
+    }
+    
+    cout << "\n  Registers:" << endl;
+    cout << "    Reg | RTL      | Golden   | Match" << endl;
+    cout << "    " << string(40, '-') << endl;
+    
+    for (int i = 0; i < 16; i++) {
+        bool reg_match = (dut->registers_out[i] == golden.gpr[i]);
+        cout << "    x" << dec << setw(2) << i << " | "
+             << "0x" << hex << setw(6) << setfill('0') << dut->registers_out[i] << " | "
+             << "0x" << setw(6) << golden.gpr[i] << " | "
+             << (reg_match ? "✓" : "✗");
+        if (!reg_match) {
+            int32_t diff = (int32_t)dut->registers_out[i] - (int32_t)golden.gpr[i];
+            cout << " (diff=" << dec << diff << ")";
+        }
+        cout << endl;
+    }
+}
+
+// Full architectural state check: PC and all 16 registers
+bool full_state_matches(Vcore* dut, const GoldenState& golden) {
+    if (dut->retire_next_pc_out != golden.pc) return false;
+    for (int i = 0; i < 16; i++) {
+        if (dut->registers_out[i] != golden.gpr[i]) return false;
+    }
+    return true;
+}
+
+// Print one side's retired register write and store
+void print_retirement(const char* who, bool we, uint32_t rd, uint32_t wdata,
+                      bool mem_we, uint32_t mem_addr, uint32_t mem_data, uint32_t mem_mask) {
+    cout << "  " << who << " = ";
+    if (we) {
+        cout << "x" << dec << rd << " <- 0x" << hex << setw(8) << setfill('0') << wdata;
+    } else {
+        cout << "no reg write";
+    }
+    if (mem_we) {
+        cout << ", mem[0x" << hex << setw(8) << setfill('0') << mem_addr << "] <- 0x"
+             << setw(8) << mem_data << " mask=0x" << mem_mask;
+    }
+    cout << endl;
+}
+
+// Cache counters of the RTL or the golden model, and the cycles the
+// core spent waiting on its caches
+struct CacheCounters {
+    uint64_t icache_hits, icache_misses;
+    uint64_t dcache_hits, dcache_misses, dcache_writebacks;
+    uint64_t stall_cycles;
+
+    static const int NUM = 6;
+    uint64_t get(int i) const {
+        const uint64_t values[NUM] = {icache_hits, icache_misses, dcache_hits,
+                                      dcache_misses, dcache_writebacks, stall_cycles};
+        return values[i];
+    }
+
+    static CacheCounters of(Vcore* dut, uint64_t stall_cycles) {
+        return {dut->icache_hit_count_out, dut->icache_miss_count_out,
+                dut->dcache_hit_count_out, dut->dcache_miss_count_out,
+                dut->dcache_writeback_count_out, stall_cycles};
+    }
+
+    static CacheCounters of(const CacheModel& icache, const CacheModel& dcache) {
+        return {icache.hits(), icache.misses(), dcache.hits(), dcache.misses(),
+                dcache.writebacks(), icache.stall_cycles() + dcache.stall_cycles()};
+    }
+};
+
+// Print the RTL's cache counters, next to the golden model's when given;
+// returns false if a compared counter differs. The RTL's stall cycles are
+// the cycles that retired nothing.
+bool print_cache_counters(const CacheCounters& rtl, const CacheCounters* golden) {
+    static const char* const names[CacheCounters::NUM] = {
+        "I-cache hits", "I-cache misses", "D-cache hits", "D-cache misses",
+        "D-cache write-backs", "stall cycles"
+    };
+    bool match = true;
+    cout << "\nCaches:" << (golden ? "  RTL / golden" : "  RTL") << endl;
+    for (int i = 0; i < CacheCounters::NUM; i++) {
+        cout << "  " << left << setw(20) << setfill(' ') << names[i] << right << dec
+             << rtl.get(i);
+        if (golden) {
+            cout << " / " << golden->get(i) << (rtl.get(i) == golden->get(i) ? "" : "  ✗");
+            match = match && rtl.get(i) == golden->get(i);
+        }
+        cout << endl;
+    }
+    return match;
+}
+
+// Close a --mem-trace or --retire-trace file, if one is being written
+template <typename TraceWriter>
+bool finish_trace(TraceWriter& trace, const string& path, const char* what) {
+    if (path.empty()) return true;
+    if (!trace.close()) {
+        cerr << "Error: Cannot write " << path << endl;
+        return false;
+    }
+    cout << what << " saved to " << path << "\n";
+    return true;
+}
+
+// A golden retirement, and the RTL's retirement this cycle, in
+// --retire-trace form
+RetireTraceRecord trace_record(const RetireRecord& rec) {
+    return {rec.next_pc, rec.we, rec.rd, rec.wdata,
+            rec.mem_we, rec.mem_mask, rec.mem_addr, rec.mem_data};
+}
+
+RetireTraceRecord trace_record(Vcore* dut) {
+    return {dut->retire_next_pc_out, static_cast<bool>(dut->retire_we_out),
+            static_cast<uint8_t>(dut->retire_rd_out), dut->retire_data_out,
+            static_cast<bool>(dut->retire_store_out),
+            static_cast<uint8_t>(dut->retire_store_mask_out), dut->retire_store_addr_out,
+            dut->retire_store_data_out};
+}
+
+// Machine-readable summary line (see the option list in main)
+void print_result(uint64_t mismatches, uint64_t cycles, uint64_t matches,
+                  uint64_t first_mismatch_cycle, uint32_t first_mismatch_pc, double seconds) {
+    cout << "RESULT status=" << (mismatches == 0 ? "pass" : "fail")
+         << " cycles=" << dec << cycles
+         << " matches=" << matches
+         << " mismatches=" << mismatches;
+    if (mismatches) {
+        cout << " first_mismatch_cycle=" << first_mismatch_cycle
+             << " first_mismatch_pc=0x" << hex << setw(8) << setfill('0') << first_mismatch_pc;
+    } else {
+        cout << " first_mismatch_cycle=- first_mismatch_pc=-";
+    }
+    cout << " seconds=" << dec << fixed << setprecision(3) << seconds << endl;
+}
+
+double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// The cache geometry is fixed at build time (build.sh passes the same
+// -D macros to the RTL); a bad one would break the golden model's caches
+static bool check_cache_config(const char* name, const CacheConfig& cfg) {
+    const char* error = cfg.error();
+    if (!error) return true;
+    cerr << "Error: " << name << "_SIZE=" << cfg.size_bytes << " " << name << "_WAYS=" << cfg.ways
+         << " " << name << "_LINE=" << cfg.line_bytes << ": " << error << endl;
+    return false;
 }
 
 int main(int argc, char** argv) {
+    if (!check_cache_config("ICACHE", ICACHE_CONFIG) ||
+        !check_cache_config("DCACHE", DCACHE_CONFIG)) {
+        return 1;
+    }
     Verilated::commandArgs(argc, argv);
-    Verilated::traceEverOn(true);
 
-    Vcore* dut = new Vcore;
-    
-    // VCD tracing
-    VerilatedVcdC* tfp = new VerilatedVcdC;
-    dut->trace(tfp, 99);
-    tfp->open("core_tb.vcd");
-    vluint64_t time = 0;
+    // Options:
+    //   --image PATH     program image (hex, .bin or ELF; default imem.hex)
+    //   --cycles N       cycles to simulate (default 100000)
+    //   --full-check N   compare the whole register file every N retired
+    //                    instructions (default 1000); others only compare
+    //                    the PC and the retired register write and store
+    //   --golden-thread  run the golden model ahead on its own thread,
+    //                    feeding retirement records through a ring buffer
+    //   --trace          dump every cycle to core_tb.vcd/.fst
+    //   --trace-range A:B
+    //                    dump only cycles A..B
+    //   --trace-window N keep the last N+ cycles in memory and write them
+    //                    out at the first mismatch (VCD only)
+    //   --trace-format vcd|fst
+    //                    waveform format; FST needs a --trace-fst build
+    //   --trace-depth N  hierarchy levels to trace (default 99 = all)
+    //   --save-checkpoint N PATH
+    //                    run the golden model alone for N instructions,
+    //                    save its state to PATH and exit (no RTL)
+    //   --restore PATH   start both the golden model and the RTL from a
+    //                    checkpoint instead of the image
+    //   --ff N           run the golden model alone for N instructions,
+    //                    then copy its state into the RTL and continue
+    //                    in lock-step (--cycles and reported cycle numbers
+    //                    count from the hand-over)
+    //   --golden-only    run only the golden model for --cycles instructions
+    //                    (no RTL, nothing checked); for benchmarking
+    //   --rtl-only       run only the RTL for --cycles cycles (no golden
+    //                    model, nothing checked); for benchmarking
+    //   --profile PATH   write a JSON profile at exit: retired instructions
+    //                    per class from the golden model and from the
+    //                    core's counters (which start at the hand-over
+    //                    with --ff/--restore), plus PC and memory-block
+    //                    histograms; with --golden-thread, of the
+    //                    retirements checked, not of the run-ahead
+    //   --mem-trace PATH write every fetch, load and store the golden
+    //                    model makes (from the hand-over on) to PATH in
+    //                    the binary format of tests/mem_trace.h, for
+    //                    cache_sim; with --golden-thread this includes
+    //                    what the golden model ran ahead of the core
+    //   --retire-trace PATH
+    //                    write every retirement (from the hand-over on) to
+    //                    PATH in the binary format of tests/retire_trace.h,
+    //                    for trace_diff: the RTL's, or the golden model's
+    //                    with --golden-only
+    // Tracing is off by default.
+    // The last line printed is a machine-readable summary for
+    // run_regression.py:
+    //   RESULT status=pass|fail cycles=N matches=N mismatches=N
+    //          first_mismatch_cycle=N|- first_mismatch_pc=0xXXXXXXXX|-
+    //          seconds=S (wall time of the simulation loop)
+    string image = "imem.hex";
+    uint64_t max_cycles = 100000;
+    uint64_t full_check_interval = 1000;
+    bool golden_thread = false;
+    uint64_t checkpoint_at = 0;
+    string checkpoint_path;
+    string restore_path;
+    uint64_t fast_forward = 0;
+    string profile_path;
+    string mem_trace_path;
+    string retire_trace_path;
+    bool golden_only = false;
+    bool rtl_only = false;
+    CoreTracer<Vcore> tracer;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--image" && i + 1 < argc) {
+            image = argv[++i];
+        } else if (arg == "--cycles" && i + 1 < argc) {
+            max_cycles = stoull(argv[++i]);
+        } else if (arg == "--full-check" && i + 1 < argc) {
+            full_check_interval = stoull(argv[++i]);
+        } else if (arg == "--golden-thread") {
+            golden_thread = true;
+        } else if (arg == "--trace") {
+            tracer.set_full();
+        } else if (arg == "--trace-range" && i + 1 < argc) {
+            string range = argv[++i];
+            size_t colon = range.find(':');
+            if (colon == string::npos) {
+                cerr << "Error: --trace-range expects A:B" << endl;
+                return 1;
+            }
+            tracer.set_range(stoull(range.substr(0, colon)), stoull(range.substr(colon + 1)));
+        } else if (arg == "--trace-window" && i + 1 < argc) {
+            tracer.set_window(stoull(argv[++i]));
+        } else if (arg == "--trace-format" && i + 1 < argc) {
+            string format = argv[++i];
+            if (!tracer.set_format(format)) {
+                cerr << "Error: trace format '" << format << "' not built into this model" << endl;
+                return 1;
+            }
+        } else if (arg == "--trace-depth" && i + 1 < argc) {
+            tracer.set_depth(stoi(argv[++i]));
+        } else if (arg == "--save-checkpoint" && i + 2 < argc) {
+            checkpoint_at = stoull(argv[++i]);
+            checkpoint_path = argv[++i];
+        } else if (arg == "--restore" && i + 1 < argc) {
+            restore_path = argv[++i];
+        } else if (arg == "--ff" && i + 1 < argc) {
+            fast_forward = stoull(argv[++i]);
+        } else if (arg == "--golden-only") {
+            golden_only = true;
+        } else if (arg == "--rtl-only") {
+            rtl_only = true;
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profile_path = argv[++i];
+        } else if (arg == "--mem-trace" && i + 1 < argc) {
+            mem_trace_path = argv[++i];
+        } else if (arg == "--retire-trace" && i + 1 < argc) {
+            retire_trace_path = argv[++i];
+        } else if (arg[0] != '+') {
+            // +args belong to Verilator; anything else is a typo or an
+            // option missing its value, not something to run defaults for
+            cerr << "Error: Unknown option " << arg
+                 << (arg.compare(0, 2, "--") == 0 ? " (or missing its value)" : "") << endl;
+            return 1;
+        }
+    }
+    if (tracer.enabled()) {
+        Verilated::traceEverOn(true);
+    }
 
-    // Initialize Golden Model and shared memory
+    // Golden model with its own copy of the program
     RV32GoldenModel golden;
-    if (!golden.load_memory("imem.hex")) {
-        cerr << "Error: Cannot load imem.hex" << endl;
+    if (!profile_path.empty()) {
+        golden.profile().enable_histograms();
+    }
+    if (!restore_path.empty()) {
+        if (!golden.restore_checkpoint(restore_path)) return 1;
+    } else if (!golden.load_memory(image)) {
+        cerr << "Error: Cannot load " << image << endl;
         return 1;
     }
+    for (uint64_t i = 0; i < fast_forward; i++) {
+        golden.step();
+    }
+    MemTraceWriter mem_trace;
+    if (!mem_trace_path.empty()) {
+        if (!mem_trace.open(mem_trace_path.c_str())) return 1;
+        golden.set_mem_trace(&mem_trace);
+    }
+    RetireTraceWriter retire_trace;
+    if (!retire_trace_path.empty() && !retire_trace.open(retire_trace_path.c_str())) {
+        return 1;
+    }
+
+    // Fast-forward to a checkpoint on the golden model alone
+    if (!checkpoint_path.empty()) {
+        for (uint64_t i = 0; i < checkpoint_at; i++) {
+            golden.step();
+        }
+        if (!golden.save_checkpoint(checkpoint_path)) return 1;
+        cout << "Checkpoint at instruction " << dec << golden.get_instret()
+             << " (PC=0x" << hex << setw(8) << setfill('0') << golden.get_pc()
+             << ") saved to " << checkpoint_path << endl;
+        return 0;
+    }
+
+    if (golden_only) {
+        auto start = chrono::steady_clock::now();
+        for (uint64_t i = 0; i < max_cycles; i++) {
+            const RetireRecord& rec = golden.step();
+            if (retire_trace.is_open()) retire_trace.write(trace_record(rec));
+        }
+        double seconds = seconds_since(start);
+        cout << "Golden model: " << dec << max_cycles << " instructions in " << fixed
+             << setprecision(3) << seconds << " s (" << setprecision(2)
+             << (seconds > 0 ? max_cycles / seconds / 1e6 : 0.0) << " MIPS)" << endl;
+        if (!profile_path.empty()) golden.profile().write_json(profile_path.c_str(), nullptr);
+        // What the single-cycle core would take with the built cache configuration
+        golden.icache_model().print("I-cache");
+        golden.dcache_model().print("D-cache");
+        uint64_t stalls = golden.icache_model().stall_cycles() + golden.dcache_model().stall_cycles();
+        cout << "Predicted core cycles: " << max_cycles + stalls << " (CPI "
+             << setprecision(3) << (max_cycles ? double(max_cycles + stalls) / max_cycles : 0.0)
+             << ")" << endl;
+        if (!finish_trace(mem_trace, mem_trace_path, "Memory trace") ||
+            !finish_trace(retire_trace, retire_trace_path, "Retirement trace")) {
+            return 1;
+        }
+        print_result(0, max_cycles, 0, 0, 0, seconds);
+        return 0;
+    }
+
+    // RTL memory must be loaded and bound before the first eval() runs
+    // the initial blocks in fetch.sv/ram.sv. A run that doesn't start at
+    // reset takes the golden model's memory as it stands.
+    bool transfer_state = !restore_path.empty() || fast_forward > 0;
+    Memory dut_mem;
+    if (transfer_state) {
+        dut_mem.copy_from(golden.memory());
+    } else if (!dut_mem.load(image.c_str())) {
+        cerr << "Error: Cannot load " << image << endl;
+        return 1;
+    }
+
+    Vcore* dut = new Vcore;
+    if (!dut_mem.bind(CORE_SCOPE ".fetch_inst") || !dut_mem.bind(CORE_SCOPE ".ram_inst")) {
+        return 1;
+    }
+    if (!tracer.open(dut, "core_tb")) {
+        return 1;
+    }
+    vluint64_t time = 0;
+
+    GoldenState golden_state = {};
+    golden_state.pc = golden.get_pc();
+    for (int i = 0; i < 16; i++) {
+        golden_state.gpr[i] = golden.get_gpr(i);
+    }
 
     cout << "==== CORE TESTBENCH WITH GOLDEN MODEL ====\n";
 
@@ -237,24 +913,87 @@ int main(int argc, char** argv) {
     // -------------------------
     cout << "Applying reset...\n";
     dut->rst = 1;
-    tick(dut, tfp, time);
-    tick(dut, tfp, time);
+    dut->state_load = 0;
+    tracer.begin_cycle(0);
+    tick(dut, tracer, time);
+    tick(dut, tracer, time);
     dut->rst = 0;
+
+    // Hand the golden PC and registers to the RTL in one state_load cycle
+    if (transfer_state) {
+        cout << "Starting RTL at instruction " << dec << golden.get_instret()
+             << " (PC=0x" << hex << setw(8) << setfill('0') << golden.get_pc() << ")\n" << dec;
+        dut->state_load = 1;
+        dut->state_load_pc = golden.get_pc();
+        for (int i = 0; i < 16; i++) {
+            dut->state_load_registers[i] = golden.get_gpr(i);
+        }
+        tick(dut, tracer, time);
+        dut->state_load = 0;
+        // The RTL's caches start cold here
+        golden.reset_caches();
+    }
+    
+    if (rtl_only) {
+        auto start = chrono::steady_clock::now();
+        uint64_t idle_cycles = 0;
+        for (uint64_t cycle = 0; cycle < max_cycles; cycle++) {
+            tracer.begin_cycle(cycle);
+            tick(dut, tracer, time);
+            idle_cycles += !dut->retire_valid_out;
+            if (dut->retire_valid_out && retire_trace.is_open()) {
+                retire_trace.write(trace_record(dut));
+            }
+        }
+        double seconds = seconds_since(start);
+        cout << "RTL: " << dec << max_cycles << " cycles in " << fixed << setprecision(3)
+             << seconds << " s (" << setprecision(0)
+             << (seconds > 0 ? max_cycles / seconds : 0.0) << " cycles/s)" << endl;
+        print_cache_counters(CacheCounters::of(dut, idle_cycles), nullptr);
+        tracer.close();
+        if (!finish_trace(retire_trace, retire_trace_path, "Retirement trace")) return 1;
+        print_result(0, max_cycles, 0, 0, 0, seconds);
+        delete dut;
+        return 0;
+    }
+
+    // Golden model runs ahead; this thread only pops and compares
+    unique_ptr<GoldenQueue> queue;
+    thread golden_worker;
+    // Profile of the checked retirements: the golden model's own counts
+    // up to the hand-over, then the records popped below
+    InstrProfile checked_profile;
+    if (golden_thread) {
+        cout << "Golden model running on its own thread\n";
+        checked_profile = golden.profile();
+        queue.reset(new GoldenQueue);
+        golden_worker = thread([&golden, &queue, max_cycles]() {
+            for (uint64_t i = 0; i < max_cycles; i++) {
+                if (!queue->push(golden.step())) break;
+            }
+            queue->close();
+        });
+    }
     
     cout << "Running core and checking against golden model...\n";
     
-    int mismatches = 0;
-    int matches = 0;
+    uint64_t mismatches = 0;
+    uint64_t matches = 0;
+    uint64_t cycles_run = 0;
+    uint64_t retired = 0;
+    // RTL cache counters as of the last retirement: the golden model has
+    // then made exactly the same accesses as the single-cycle core
+    CacheCounters rtl_caches = CacheCounters::of(dut, 0);
+    uint64_t first_mismatch_cycle = 0;
+    uint32_t first_mismatch_pc = 0;
     
-    // Store last few cycles for context
+    // Store last few retirements for context
     const int CONTEXT_SIZE = 5;
     struct CycleInfo {
-        int cycle;
+        uint64_t cycle;
         uint32_t rtl_pc;
-        uint32_t golden_pc;
-        uint32_t rtl_regs[16];
-        uint32_t golden_regs[16];
-        uint32_t instruction;
+        RetireRecord golden;
+        bool match;
     };
     CycleInfo history[CONTEXT_SIZE];
     int history_idx = 0;
@@ -262,101 +1001,81 @@ int main(int argc, char** argv) {
     // -------------------------
     // Run for N cycles
     // -------------------------
-    for (int cycle = 0; cycle < 100000; cycle++) {
-        // Store state before tick for debugging
-        uint32_t pre_instruction = 0;
-        if (cycle > 0) {
-            // Fetch instruction from memory manually for debugging
-            uint32_t pc_word = (golden.get_pc() >> 2) & 0xFF;
-            // We'll read it from the fetch output after tick
-        }
-        
-        tick(dut, tfp, time);
-        golden.step();
-        
-        // Store cycle info in circular buffer
-        history[history_idx].cycle = cycle;
-        history[history_idx].rtl_pc = dut->pc_out;
-        history[history_idx].golden_pc = golden.get_pc();
-        history[history_idx].instruction = 0; // Will be filled if needed
-        for (int i = 0; i < 16; i++) {
-            history[history_idx].rtl_regs[i] = dut->registers_out[i];
-            history[history_idx].golden_regs[i] = golden.get_gpr(i);
+    auto run_start = chrono::steady_clock::now();
+    for (uint64_t cycle = 0; cycle < max_cycles; cycle++) {
+        tracer.begin_cycle(cycle);
+        tick(dut, tracer, time);
+        cycles_run = cycle + 1;
+        // Compare at retirement: the pipelined core has bubbles while it
+        // fills, stalls or flushes, and the golden model only steps when
+        // the RTL retires an instruction
+        if (!dut->retire_valid_out) continue;
+        if (retire_trace.is_open()) retire_trace.write(trace_record(dut));
+        RetireRecord rec;
+        if (golden_thread) {
+            if (!queue->pop(rec)) break;
+            if (!profile_path.empty()) profile_record(checked_profile, rec);
+        } else {
+            rec = golden.step();
         }
-        history_idx = (history_idx + 1) % CONTEXT_SIZE;
+        golden_state.apply(rec);
+        retired++;
+        rtl_caches = CacheCounters::of(dut, cycles_run - retired);
         
-        // Compare RTL with Golden Model
-        bool cycle_match = true;
+        // Compare only what this instruction changed. With the previous
+        // state already equal, the register files still agree iff each
+        // side's write landed with the same value on the other side.
+        bool cycle_match = dut->retire_next_pc_out == rec.next_pc &&
+                           (!dut->retire_we_out ||
+                            golden_state.gpr[dut->retire_rd_out & 0xF] == dut->retire_data_out) &&
+                           (!rec.we || dut->registers_out[rec.rd] == rec.wdata) &&
+                           store_matches(dut, rec);
         
-        // Check PC
-        if (dut->pc_out != golden.get_pc()) {
-            cycle_match = false;
+        // Periodic full-state check catches anything the deltas miss
+        if (cycle_match && full_check_interval && retired % full_check_interval == 0) {
+            cycle_match = full_state_matches(dut, golden_state);
         }
         
-        // Check all registers
-        for (int i = 0; i < 16; i++) {
-            if (dut->registers_out[i] != golden.get_gpr(i)) {
-                cycle_match = false;
-                break;
-            }
-        }
+        CycleInfo& info = history[history_idx];
+        info.cycle = cycle;
+        info.rtl_pc = dut->retire_next_pc_out;
+        info.golden = rec;
+        info.match = cycle_match;
+        history_idx = (history_idx + 1) % CONTEXT_SIZE;
         
         if (!cycle_match) {
-            mismatches++;
+            if (mismatches++ == 0) {
+                first_mismatch_cycle = cycle;
+                first_mismatch_pc = rec.pc;
+            }
+            tracer.trigger();
             cout << "\n" << string(80, '=') << endl;
             cout << "❌ MISMATCH DETECTED at Cycle " << dec << cycle << endl;
             cout << string(80, '=') << endl;
             
-            // Get the instruction that was executed
-            uint32_t prev_pc = cycle > 0 ? history[(history_idx + CONTEXT_SIZE - 1) % CONTEXT_SIZE].golden_pc : 0;
-            uint32_t instr = golden.get_instruction_at_pc();
-            
             cout << "\nInstruction being executed:" << endl;
-            cout << "  PC = 0x" << hex << setw(8) << setfill('0') << prev_pc << endl;
-            cout << "  " << RV32GoldenModel::decode_instruction(instr) << endl;
+            cout << "  PC = 0x" << hex << setw(8) << setfill('0') << rec.pc << endl;
+            cout << "  " << RV32GoldenModel::decode_instruction(rec.instr) << endl;
+            
+            cout << "\nRetired:" << endl;
+            print_retirement("RTL   ", dut->retire_we_out, dut->retire_rd_out, dut->retire_data_out,
+                             dut->retire_store_out, dut->retire_store_addr_out,
+                             dut->retire_store_data_out, dut->retire_store_mask_out);
+            print_retirement("Golden", rec.we, rec.rd, rec.wdata,
+                             rec.mem_we, rec.mem_addr, rec.mem_data, rec.mem_mask);
             
             // Show last few cycles for context
             cout << "\nContext (last " << CONTEXT_SIZE << " cycles):" << endl;
-            for (int i = 0; i < CONTEXT_SIZE; i++) {
-                int idx = (history_idx + i) % CONTEXT_SIZE;
-                if (history[idx].cycle < cycle - CONTEXT_SIZE + 1) continue;
-                
-                bool was_match = true;
-                if (history[idx].rtl_pc != history[idx].golden_pc) was_match = false;
-                for (int r = 0; r < 16 && was_match; r++) {
-                    if (history[idx].rtl_regs[r] != history[idx].golden_regs[r]) was_match = false;
-                }
-                
-                cout << "  Cycle " << dec << setw(5) << history[idx].cycle 
-                     << ": PC=0x" << hex << setw(8) << setfill('0') << history[idx].rtl_pc
-                     << (was_match ? " ✓" : " ✗") << endl;
-            }
-            
-            cout << "\nCurrent State Comparison:" << endl;
-            cout << "  PC:" << endl;
-            cout << "    RTL    = 0x" << hex << setw(8) << setfill('0') << dut->pc_out << endl;
-            cout << "    Golden = 0x" << setw(8) << golden.get_pc() << endl;
-            if (dut->pc_out != golden.get_pc()) {
-                cout << "    DIFF   = " << (dut->pc_out > golden.get_pc() ? "+" : "") 
-                     << dec << (int32_t)(dut->pc_out - golden.get_pc()) << endl;
+            int shown = retired < CONTEXT_SIZE ? (int)retired : CONTEXT_SIZE;
+            for (int i = CONTEXT_SIZE - shown; i < CONTEXT_SIZE; i++) {
+                const CycleInfo& h = history[(history_idx + i) % CONTEXT_SIZE];
+                cout << "  Cycle " << dec << setw(5) << setfill(' ') << h.cycle 
+                     << ": PC=0x" << hex << setw(8) << setfill('0') << h.golden.pc
+                     << " -> 0x" << setw(8) << h.rtl_pc
+                     << (h.match ? " ✓" : " ✗") << endl;
             }
             
-            cout << "\n  Registers:" << endl;
-            cout << "    Reg | RTL      | Golden   | Match" << endl;
-            cout << "    " << string(40, '-') << endl;
-            
-            for (int i = 0; i < 16; i++) {
-                bool reg_match = (dut->registers_out[i] == golden.get_gpr(i));
-                cout << "    x" << dec << setw(2) << i << " | "
-                     << "0x" << hex << setw(6) << setfill('0') << dut->registers_out[i] << " | "
-                     << "0x" << setw(6) << golden.get_gpr(i) << " | "
-                     << (reg_match ? "✓" : "✗");
-                if (!reg_match) {
-                    int32_t diff = (int32_t)dut->registers_out[i] - (int32_t)golden.get_gpr(i);
-                    cout << " (diff=" << dec << diff << ")";
-                }
-                cout << endl;
-            }
+            print_state_comparison(dut, golden_state);
             
             cout << string(80, '=') << endl;
             
@@ -369,15 +1088,55 @@ int main(int argc, char** argv) {
             matches++;
         }
         
-        // Print progress every 10000 cycles
-        if (cycle % 10000 == 0 && cycle > 0) {
+        // Print progress every 10000 retired instructions
+        if (retired % 10000 == 0) {
             cout << "✓ Cycle " << dec << cycle << ": " << matches << " matches, " 
                  << mismatches << " mismatches" << endl;
         }
     }
 
+    if (golden_thread) {
+        queue->close();
+        golden_worker.join();
+    }
+    double run_seconds = seconds_since(run_start);
+    if (!finish_trace(mem_trace, mem_trace_path, "Memory trace") ||
+        !finish_trace(retire_trace, retire_trace_path, "Retirement trace")) {
+        return 1;
+    }
+
+    // Cache counters must agree with the golden model's caches. Not on the
+    // pipelined core, which also fetches down paths it later flushes and
+    // has younger accesses in flight, nor when the golden model ran ahead.
+#ifdef CORE_PIPE
+    const bool check_caches = false;
+#else
+    const bool check_caches = !golden_thread;
+#endif
+    if (check_caches) {
+        CacheCounters golden_caches = CacheCounters::of(golden.icache_model(),
+                                                        golden.dcache_model());
+        if (!print_cache_counters(rtl_caches, &golden_caches) && mismatches++ == 0) {
+            first_mismatch_cycle = cycles_run ? cycles_run - 1 : 0;
+            first_mismatch_pc = golden_state.pc;
+            cout << "\n❌ MISMATCH in cache counters" << endl;
+        }
+    } else {
+        print_cache_counters(CacheCounters::of(dut, cycles_run - retired), nullptr);
+    }
+
+    // Final full-state check so a run never ends on an unchecked state
+    if (mismatches == 0 && !full_state_matches(dut, golden_state)) {
+        mismatches++;
+        first_mismatch_cycle = cycles_run ? cycles_run - 1 : 0;
+        first_mismatch_pc = golden_state.pc;
+        tracer.trigger();
+        cout << "\n❌ MISMATCH in final full-state check" << endl;
+        print_state_comparison(dut, golden_state);
+    }
+
     cout << "\n==== CORE TEST COMPLETED ====\n";
-    cout << "Total: " << matches << " matches, " << mismatches << " mismatches" << endl;
+    cout << "Total: " << dec << matches << " matches, " << mismatches << " mismatches" << endl;
     
     if (mismatches == 0) {
         cout << "✅ ALL TESTS PASSED!" << endl;
@@ -385,10 +1144,25 @@ int main(int argc, char** argv) {
         cout << "❌ TESTS FAILED with " << mismatches << " mismatches" << endl;
     }
     
-    cout << "Waveform saved to core_tb.vcd\n";
+    if (!profile_path.empty()) {
+        uint64_t rtl_counts[NUM_INSTR_CLASSES];
+        for (int i = 0; i < NUM_INSTR_CLASSES; i++) {
+            rtl_counts[i] = dut->perf_class_count_out[i];
+        }
+        const InstrProfile& prof = golden_thread ? checked_profile : golden.profile();
+        if (prof.write_json(profile_path.c_str(), rtl_counts)) {
+            cout << "Profile saved to " << profile_path << "\n";
+        }
+    }
+
+    tracer.close();
+    if (!tracer.written_path().empty()) {
+        cout << "Waveform saved to " << tracer.written_path() << "\n";
+    }
+
+    print_result(mismatches, cycles_run, matches, first_mismatch_cycle, first_mismatch_pc,
+                 run_seconds);
 
-    tfp->close();
-    delete tfp;
     delete dut;
     return (mismatches == 0) ? 0 : 1;
 }
@@ -0,0 +1,274 @@
+#pragma once
+#include <verilated.h>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Trace formats compiled into the model. verilated.mk passes these from
+// the --trace / --trace-fst options the model was built with; older
+// Verilator only sets VM_TRACE/VM_TRACE_FST, where no FST means VCD.
+#ifndef VM_TRACE
+#define VM_TRACE 1
+#endif
+#ifndef VM_TRACE_FST
+#define VM_TRACE_FST 0
+#endif
+#ifndef VM_TRACE_VCD
+#define VM_TRACE_VCD (VM_TRACE && !VM_TRACE_FST)
+#endif
+
+#if VM_TRACE_VCD
+#include <verilated_vcd_c.h>
+#endif
+#if VM_TRACE_FST
+#include <verilated_fst_c.h>
+#endif
+
+#if VM_TRACE_VCD
+
+// VCD sink that keeps the waves in memory instead of writing a file.
+// Every openNext() on the owning VerilatedVcdC starts a new segment (which
+// begins with a full dump of all signals); only the current and previous
+// segments are kept, so memory stays bounded at about two windows.
+class VcdWindowFile : public VerilatedVcdFile {
+private:
+    std::string header;     // $var declarations, written once by open()
+    std::string prev;
+    std::string cur;
+
+    // Move the declaration header out of the first segment
+    void split_header() {
+        static const std::string end_defs = "$enddefinitions $end";
+        size_t pos = cur.find(end_defs);
+        if (pos == std::string::npos) return;
+        pos = cur.find('\n', pos);
+        pos = (pos == std::string::npos) ? cur.size() : pos + 1;
+        if (header.empty()) header = cur.substr(0, pos);
+        cur.erase(0, pos);
+    }
+
+public:
+    bool open(const std::string&) override {
+        split_header();
+        prev.swap(cur);
+        cur.clear();
+        return true;
+    }
+
+    void close() override {
+        split_header();
+    }
+
+    ssize_t write(const char* bufp, ssize_t len) override {
+        cur.append(bufp, len);
+        return len;
+    }
+
+    // Header + previous + current segment form one valid VCD: the full
+    // dump that opens the current segment just restates every value.
+    bool save(const std::string& path) {
+        split_header();
+        FILE* fp = std::fopen(path.c_str(), "w");
+        if (!fp) {
+            std::perror("VcdWindowFile fopen");
+            return false;
+        }
+        std::fwrite(header.data(), 1, header.size(), fp);
+        std::fwrite(prev.data(), 1, prev.size(), fp);
+        std::fwrite(cur.data(), 1, cur.size(), fp);
+        std::fclose(fp);
+        return true;
+    }
+};
+
+#endif
+
+// Waveform control for the core testbench. Tracing is off unless one of
+// the modes below is selected:
+//   FULL    every cycle, straight to the file
+//   RANGE   only cycles [range_begin, range_end], straight to the file
+//   WINDOW  the last ~window cycles, kept in memory and written to the
+//           file only when trigger() is called (first mismatch); VCD only
+// Waves go to VCD or, for models built with --trace-fst, to compressed
+// FST (add --trace-threads at Verilator time to move FST compression
+// onto its own thread).
+template <typename Model>
+class CoreTracer {
+public:
+    enum Mode { OFF, FULL, RANGE, WINDOW };
+    enum Format { VCD, FST };
+
+    CoreTracer() : mode(OFF), format(VM_TRACE_VCD ? VCD : FST), depth(99),
+                   range_begin(0), range_end(0), window(0),
+                   active(false), is_open(false), triggered(false) {
+#if VM_TRACE_VCD
+        window_file = nullptr;
+        vcd = nullptr;
+#endif
+#if VM_TRACE_FST
+        fst = nullptr;
+#endif
+    }
+
+    ~CoreTracer() {
+        close();
+    }
+
+    void set_full() { mode = FULL; }
+
+    void set_range(uint64_t begin, uint64_t end) {
+        mode = RANGE;
+        range_begin = begin;
+        range_end = end;
+    }
+
+    void set_window(uint64_t cycles) {
+        mode = WINDOW;
+        window = cycles ? cycles : 1;
+    }
+
+    // Hierarchy levels below the top to trace (Verilator's trace depth)
+    void set_depth(int levels) { depth = levels; }
+
+    // Select "vcd" or "fst"; false if the model wasn't built with it
+    bool set_format(const std::string& name) {
+        if (name == "vcd" && VM_TRACE_VCD) {
+            format = VCD;
+            return true;
+        }
+        if (name == "fst" && VM_TRACE_FST) {
+            format = FST;
+            return true;
+        }
+        return false;
+    }
+
+    bool enabled() const { return mode != OFF; }
+
+    // Open <base>.vcd or <base>.fst; call after Verilated::traceEverOn(true)
+    bool open(Model* dut, const std::string& base) {
+        if (mode == OFF) return true;
+#if !VM_TRACE_VCD && !VM_TRACE_FST
+        (void)dut;
+        (void)base;
+        std::fprintf(stderr, "Error: model was built without tracing\n");
+        return false;
+#endif
+        if (mode == WINDOW && format != VCD) {
+            std::fprintf(stderr, "Error: --trace-window needs a VCD trace build\n");
+            return false;
+        }
+#if VM_TRACE_VCD
+        if (format == VCD) {
+            path = base + ".vcd";
+            if (mode == WINDOW) window_file = new VcdWindowFile;
+            vcd = new VerilatedVcdC(window_file);
+            dut->trace(vcd, depth);
+            vcd->open(path.c_str());
+        }
+#endif
+#if VM_TRACE_FST
+        if (format == FST) {
+            path = base + ".fst";
+            fst = new VerilatedFstC;
+            dut->trace(fst, depth);
+            fst->open(path.c_str());
+        }
+#endif
+        is_open = true;
+        return true;
+    }
+
+    // Start cycle n: decide whether its dumps are kept
+    void begin_cycle(uint64_t n) {
+        active = false;
+        if (!is_open) return;
+        switch (mode) {
+            case FULL:
+                active = true;
+                break;
+            case RANGE:
+                active = n >= range_begin && n <= range_end;
+                break;
+            case WINDOW:
+                if (triggered) break;
+                // Rotate segments so at least `window` cycles stay buffered
+#if VM_TRACE_VCD
+                if (n > 0 && n % window == 0) vcd->openNext(false);
+#endif
+                active = true;
+                break;
+            default:
+                break;
+        }
+    }
+
+    void dump(uint64_t time) {
+        if (!active) return;
+#if VM_TRACE_VCD
+        if (vcd) vcd->dump(time);
+#endif
+#if VM_TRACE_FST
+        if (fst) fst->dump(time);
+#endif
+    }
+
+    // First mismatch: write out the buffered window and stop tracing
+    void trigger() {
+        if (mode != WINDOW || triggered || !is_open) return;
+        triggered = true;
+        active = false;
+#if VM_TRACE_VCD
+        vcd->flush();
+        if (window_file->save(path)) {
+            std::printf("Trace window (last %llu+ cycles) saved to %s\n",
+                        static_cast<unsigned long long>(window), path.c_str());
+        }
+#endif
+    }
+
+    // Path of the waveform written, or "" if none was
+    std::string written_path() const {
+        if (mode == FULL || mode == RANGE || (mode == WINDOW && triggered)) return path;
+        return "";
+    }
+
+    void close() {
+        if (!is_open) return;
+#if VM_TRACE_VCD
+        if (vcd) {
+            vcd->close();
+            delete vcd;
+            delete window_file;
+            vcd = nullptr;
+            window_file = nullptr;
+        }
+#endif
+#if VM_TRACE_FST
+        if (fst) {
+            fst->close();
+            delete fst;
+            fst = nullptr;
+        }
+#endif
+        is_open = false;
+    }
+
+private:
+    Mode mode;
+    Format format;
+    int depth;
+    uint64_t range_begin, range_end;
+    uint64_t window;
+    std::string path;
+    bool active;
+    bool is_open;
+    bool triggered;
+#if VM_TRACE_VCD
+    VcdWindowFile* window_file;
+    VerilatedVcdC* vcd;
+#endif
+#if VM_TRACE_FST
+    VerilatedFstC* fst;
+#endif
+};
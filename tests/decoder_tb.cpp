@@ -2,6 +2,7 @@
 #include <iostream>                     // For std::cout / std::cerr
 #include <iomanip>                      // For std::setw / std::setfill formatting
 #include "Vdecoder.h"                        // Generated model header for pc
+#include "rv32_decoder.h"               // C++ decoder the golden models use
 using namespace std;
 int main(int argc, char** argv){
     Verilated::commandArgs(argc, argv); // Pass command-line args to Verilator (e.g., +trace)
@@ -14,9 +15,17 @@ int main(int argc, char** argv){
         0x00334283, // lbu x5, 3(x6)
         0x00532623, // sw x5, 12(x6)
         0x005300A3, // sb x5, 1(x6)
-        0x000280E7 // jalr x1, 0(x5)
+        0x000280E7, // jalr x1, 0(x5)
+        0x40730333, // sub x6, x6, x7
+        0x4052D293, // srai x5, x5, 5
+        0x00001297, // auipc x5, 0x1
+        0x00C0016F, // jal x2, +12
+        0xFE729CE3, // bne x5, x7, -8
+        0x00531423, // sh x5, 8(x6)
+        0xFFE31283  // lh x5, -2(x6)
     };
-    for(int i = 0; i < 8; i++) {
+    const int num_instructions = sizeof(instructions) / sizeof(instructions[0]);
+    for(int i = 0; i < num_instructions; i++) {
         top->instruction = instructions[i];
         top->eval();                   // Initial evaluation with reset
         cout << "Instruction: 0x"
@@ -33,10 +42,34 @@ cout << "  rs2    : " << (int)top->rs2 << "\n";
 
 cout << "  imm_u  : " << (int)top->imm_u << "\n";
 cout << "  imm_i  : " << (int)top->imm_i << "\n";
+cout << "  imm_s  : " << (int)top->imm_s << "\n";
+cout << "  imm_b  : " << (int)top->imm_b << "\n";
+cout << "  imm_j  : " << (int)top->imm_j << "\n";
+cout << "  class  : " << (int)top->op_class << " (" << rv32_disasm(instructions[i]) << ")\n";
 
 cout << "------------------------\n";
 
     }
+    // op_class must agree with the golden models' decoder for every
+    // opcode/funct3/funct7 combination
+    int mismatches = 0;
+    for (uint32_t opcode = 0; opcode < 128; opcode++) {
+        for (uint32_t funct3 = 0; funct3 < 8; funct3++) {
+            for (uint32_t funct7 = 0; funct7 < 128; funct7++) {
+                uint32_t instr = (funct7 << 25) | (funct3 << 12) | opcode;
+                top->instruction = instr;
+                top->eval();
+                if (top->op_class != rv32_op(instr)) {
+                    if (mismatches++ < 10) {
+                        cout << "op_class mismatch for 0x" << hex << setw(8) << setfill('0')
+                             << instr << dec << ": RTL " << (int)top->op_class
+                             << ", rv32_decoder.h " << (int)rv32_op(instr) << "\n";
+                    }
+                }
+            }
+        }
+    }
+    cout << "op_class check: " << mismatches << " mismatches\n";
     delete top;                    // Clean up
-    return 0;
+    return mismatches ? 1 : 0;
 }
@@ -29,6 +29,7 @@ int main(int argc, char** argv) {
     dut->rs2 = 0;
     dut->rd  = 0;
     dut->write_data = 0;
+    dut->load_enable = 0;
 
     tick(dut);  // apply reset
     dut->rst = 0;
@@ -92,6 +93,24 @@ int main(int argc, char** argv) {
 
     cout << "Overwrite test passed\n";
 
+    // -------------------------
+    // Checkpoint load test
+    // -------------------------
+    for (int i = 0; i < 16; i++) {
+        dut->load_data[i] = 0x1000 + i;
+    }
+    dut->load_enable = 1;
+    tick(dut);
+    dut->load_enable = 0;
+
+    for (int i = 0; i < 16; i++) {
+        dut->rs1 = i;
+        dut->eval();
+        assert(dut->read_data1 == (i == 0 ? 0u : 0x1000u + i));
+    }
+
+    cout << "Load test passed\n";
+
     cout << "==== ALL GPR TESTS PASSED ====\n";
 
     delete dut;
@@ -0,0 +1,174 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Binary memory-access trace: every instruction fetch, load and store the
+// golden model makes, in program order. Written by core_tb --mem-trace,
+// read by cache_sim.
+//
+//   header   "RVMT" then one version byte (1)
+//   record   tag byte, then an optional address delta
+//     tag bits 1:0  kind: 0 fetch, 1 load, 2 store
+//     tag bits 3:2  log2 of the access size in bytes (fetches are 4)
+//     tag bit 4     sequential: the address is the previous one of its
+//                   stream plus this access's size; no delta follows
+//     tag bits 7:5  0
+//     delta         address minus the previous one of its stream, mod
+//                   2^32, as a zigzag-encoded LEB128 varint (1-5 bytes)
+//
+// Fetches form one stream and loads/stores the other; both start at
+// address 0. Straight-line code costs one byte per fetch, and most data
+// accesses two.
+enum MemAccessKind : uint8_t {
+    MEM_FETCH = 0,
+    MEM_LOAD = 1,
+    MEM_STORE = 2
+};
+
+struct MemAccess {
+    MemAccessKind kind;
+    uint8_t size;       // 1, 2 or 4 bytes
+    uint32_t addr;
+};
+
+class MemTraceWriter {
+public:
+    MemTraceWriter() : fp(nullptr), len(0), buf(BUF_SIZE) {}
+    ~MemTraceWriter() { close(); }
+    MemTraceWriter(const MemTraceWriter&) = delete;
+    MemTraceWriter& operator=(const MemTraceWriter&) = delete;
+
+    bool open(const char* path) {
+        close();
+        fp = std::fopen(path, "wb");
+        if (!fp) {
+            std::perror("MemTraceWriter fopen");
+            return false;
+        }
+        static const uint8_t header[5] = {'R', 'V', 'M', 'T', 1};
+        std::fwrite(header, 1, sizeof(header), fp);
+        prev[0] = prev[1] = 0;
+        return true;
+    }
+
+    void fetch(uint32_t addr) { put(MEM_FETCH, 4, addr); }
+    void load(uint32_t addr, uint32_t size) { put(MEM_LOAD, size, addr); }
+    void store(uint32_t addr, uint32_t size) { put(MEM_STORE, size, addr); }
+
+    // Flush and close; true if every write succeeded
+    bool close() {
+        if (!fp) return true;
+        flush();
+        bool ok = !std::ferror(fp);
+        ok = std::fclose(fp) == 0 && ok;
+        fp = nullptr;
+        return ok;
+    }
+
+private:
+    static const size_t BUF_SIZE = 1 << 20;
+    static const size_t MAX_RECORD = 6;
+
+    FILE* fp;
+    size_t len;
+    std::vector<uint8_t> buf;
+    uint32_t prev[2];       // last address of the fetch and data streams
+
+    void put(MemAccessKind kind, uint32_t size, uint32_t addr) {
+        if (len > BUF_SIZE - MAX_RECORD) flush();
+        uint8_t* p = &buf[len];
+        uint32_t& last = prev[kind != MEM_FETCH];
+        uint8_t tag = kind | ((size == 4 ? 2 : size == 2 ? 1 : 0) << 2);
+        uint32_t delta = addr - last;
+        last = addr;
+        if (delta == size) {
+            p[0] = tag | 0x10;
+            len += 1;
+            return;
+        }
+        p[0] = tag;
+        uint32_t z = (delta << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(delta) >> 31);
+        size_t n = 1;
+        while (z >= 0x80) {
+            p[n++] = static_cast<uint8_t>(z | 0x80);
+            z >>= 7;
+        }
+        p[n++] = static_cast<uint8_t>(z);
+        len += n;
+    }
+
+    void flush() {
+        if (len) std::fwrite(buf.data(), 1, len, fp);
+        len = 0;
+    }
+};
+
+class MemTraceReader {
+public:
+    MemTraceReader() : fp(nullptr), pos(0), len(0), eof(false), buf(BUF_SIZE) {}
+    ~MemTraceReader() { if (fp) std::fclose(fp); }
+    MemTraceReader(const MemTraceReader&) = delete;
+    MemTraceReader& operator=(const MemTraceReader&) = delete;
+
+    bool open(const char* path) {
+        fp = std::fopen(path, "rb");
+        if (!fp) {
+            std::perror("MemTraceReader fopen");
+            return false;
+        }
+        uint8_t header[5];
+        if (std::fread(header, 1, sizeof(header), fp) != sizeof(header) ||
+            header[0] != 'R' || header[1] != 'V' || header[2] != 'M' || header[3] != 'T' ||
+            header[4] != 1) {
+            std::fprintf(stderr, "MemTraceReader: %s is not a version 1 memory trace\n", path);
+            return false;
+        }
+        prev[0] = prev[1] = 0;
+        return true;
+    }
+
+    // Next access; false at the end of the trace (or on a truncated record)
+    bool next(MemAccess& a) {
+        if (len - pos < MAX_RECORD && !eof) refill();
+        if (pos == len) return false;
+        uint8_t tag = buf[pos++];
+        a.kind = static_cast<MemAccessKind>(tag & 0x3);
+        a.size = static_cast<uint8_t>(1u << ((tag >> 2) & 0x3));
+        uint32_t& last = prev[a.kind != MEM_FETCH];
+        if (tag & 0x10) {
+            last += a.size;
+        } else {
+            uint32_t z = 0;
+            for (int shift = 0;; shift += 7) {
+                if (pos == len) return false;
+                uint8_t b = buf[pos++];
+                z |= static_cast<uint32_t>(b & 0x7F) << shift;
+                if (!(b & 0x80)) break;
+            }
+            last += (z >> 1) ^ (0u - (z & 1));
+        }
+        a.addr = last;
+        return true;
+    }
+
+private:
+    static const size_t BUF_SIZE = 1 << 20;
+    static const size_t MAX_RECORD = 6;
+
+    FILE* fp;
+    size_t pos, len;
+    bool eof;
+    std::vector<uint8_t> buf;
+    uint32_t prev[2];
+
+    void refill() {
+        size_t left = len - pos;
+        for (size_t i = 0; i < left; i++) buf[i] = buf[pos + i];
+        pos = 0;
+        len = left;
+        size_t n = std::fread(&buf[len], 1, BUF_SIZE - len, fp);
+        len += n;
+        if (n == 0) eof = true;
+    }
+};
@@ -1,65 +1,303 @@
 #include "memory.h"
 
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
-#include <string>
+#include <svdpi.h>
 
-static unsigned char memory[MEM_SIZE];
-static bool initialized = false;
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-static inline uint32_t clamp_addr(uint32_t addr) {
-    // Word-align and clamp to MEM_SIZE-4 (avoid overflow on last word)
-    uint32_t aligned = addr & ~0x3u;
-    if (aligned >= MEM_SIZE - 4) return (MEM_SIZE - 4);
-    return aligned;
+// Page slots come zeroed from calloc, so an instance costs no RSS until
+// its pages are touched
+static_assert(sizeof(std::atomic<unsigned char *>) == sizeof(unsigned char *) &&
+              std::atomic<unsigned char *>::is_always_lock_free,
+              "page slots must be plain lock-free pointers");
+
+// Instance ids start at 1 so a thread's empty page cache never matches
+static std::atomic<uint64_t> next_id(1);
+
+Memory::Memory()
+    : pages(static_cast<PageSlot *>(std::calloc(NUM_PAGES, sizeof(PageSlot)))),
+      id(next_id++), image_map(nullptr), image_size(0), is_initialized(false) {
+    if (!pages) {
+        std::perror("Memory page table calloc");
+        std::abort();
+    }
 }
 
-extern "C" void mem_init(const char *path) {
-    if (initialized) return;
-    initialized = true;
-    std::memset(memory, 0, sizeof(memory));
+Memory::~Memory() {
+    clear();
+    std::free(pages);
+}
+
+Memory &Memory::global() {
+    static Memory mem;
+    return mem;
+}
+
+// Two threads may miss on the same page; the first to publish wins
+unsigned char *Memory::alloc_page(uint32_t num) {
+    unsigned char *p = static_cast<unsigned char *>(std::calloc(1, PAGE_SIZE));
+    if (!p) {
+        std::perror("mem page calloc");
+        std::abort();
+    }
+    unsigned char *expected = nullptr;
+    if (!pages[num].compare_exchange_strong(expected, p, std::memory_order_acq_rel)) {
+        std::free(p);
+        p = expected;
+    }
+    cached() = {id, num, p};
+    return p;
+}
+
+void Memory::clear() {
+    for (uint32_t i = 0; i < NUM_PAGES; i++) {
+        unsigned char *p = pages[i].load(std::memory_order_relaxed);
+        if (p && !(p >= image_map && p < image_map + image_size)) std::free(p);
+        pages[i].store(nullptr, std::memory_order_relaxed);
+    }
+    if (image_map) {
+        munmap(image_map, image_size);
+        image_map = nullptr;
+        image_size = 0;
+    }
+    // Every thread's cached page pointer for this instance is now stale
+    id = next_id++;
+}
+
+bool Memory::save_pages(FILE *fp) const {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < NUM_PAGES; i++) {
+        if (pages[i].load(std::memory_order_relaxed)) count++;
+    }
+    if (std::fwrite(&count, sizeof(count), 1, fp) != 1) return false;
+    for (uint32_t i = 0; i < NUM_PAGES; i++) {
+        unsigned char *p = pages[i].load(std::memory_order_relaxed);
+        if (!p) continue;
+        if (std::fwrite(&i, sizeof(i), 1, fp) != 1) return false;
+        if (std::fwrite(p, PAGE_SIZE, 1, fp) != 1) return false;
+    }
+    return true;
+}
+
+bool Memory::load_pages(FILE *fp) {
+    clear();
+    is_initialized = true;
+    uint32_t count;
+    if (std::fread(&count, sizeof(count), 1, fp) != 1) return false;
+    for (uint32_t n = 0; n < count; n++) {
+        uint32_t num;
+        if (std::fread(&num, sizeof(num), 1, fp) != 1 || num >= NUM_PAGES) return false;
+        unsigned char *p = pages[num].load(std::memory_order_relaxed);
+        if (!p) p = alloc_page(num);
+        if (std::fread(p, PAGE_SIZE, 1, fp) != 1) return false;
+    }
+    return true;
+}
 
-    const char *file = path && path[0] ? path : "imem.hex";
-    FILE *fp = std::fopen(file, "r");
-    if (!fp) {
-        std::perror("mem_init fopen");
-        return;
+void Memory::copy_from(const Memory &other) {
+    if (&other == this) return;
+    clear();
+    is_initialized = true;
+    for (uint32_t i = 0; i < NUM_PAGES; i++) {
+        unsigned char *p = other.pages[i].load(std::memory_order_relaxed);
+        if (p) std::memcpy(alloc_page(i), p, PAGE_SIZE);
     }
-    char line[128];
+}
+
+static inline int hex_digit(unsigned char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Hex image: one 32-bit word per line from address 0. Lines starting with
+// '#' and lines without a leading hex number are skipped; anything after
+// the number is ignored (same rules as the old fgets/sscanf loader).
+void Memory::load_hex(const char *text, size_t size) {
+    const char *p = text;
+    const char *end = text + size;
     uint32_t addr = 0;
-    while (std::fgets(line, sizeof(line), fp)) {
-        // Skip empty/comment lines
-        if (line[0] == '#' || line[0] == '\n' || line[0] == '\0') continue;
+    while (p < end && addr < MEM_SIZE) {
+        const char *eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (!eol) eol = end;
+        const char *q = p;
+        p = eol + 1;
+        if (*q == '#') continue;
+        while (q < eol && (*q == ' ' || *q == '\t' || *q == '\r')) q++;
+        if (eol - q > 2 && q[0] == '0' && (q[1] | 0x20) == 'x' && hex_digit(q[2]) >= 0) q += 2;
+        int d = q < eol ? hex_digit(*q) : -1;
+        if (d < 0) continue;
         uint32_t word = 0;
-        if (std::sscanf(line, "%x", &word) != 1) continue;
-        uint32_t a = clamp_addr(addr);
-        memory[a + 0] = (word >> 0) & 0xFF;
-        memory[a + 1] = (word >> 8) & 0xFF;
-        memory[a + 2] = (word >> 16) & 0xFF;
-        memory[a + 3] = (word >> 24) & 0xFF;
+        for (; q < eol && (d = hex_digit(*q)) >= 0; q++) word = (word << 4) | d;
+        unsigned char *w = get_page(addr) + (addr & (PAGE_SIZE - 1));
+        w[0] = (word >> 0) & 0xFF;
+        w[1] = (word >> 8) & 0xFF;
+        w[2] = (word >> 16) & 0xFF;
+        w[3] = (word >> 24) & 0xFF;
         addr += 4;
-        if (addr >= MEM_SIZE) break;
     }
-    std::fclose(fp);
+}
+
+// Raw binary image at address 0: hand the mapping's pages to the page
+// table instead of copying them
+void Memory::map_binary(unsigned char *map, size_t size) {
+    image_map = map;
+    image_size = size;
+    size_t n = (size < MEM_SIZE ? size : MEM_SIZE);
+    for (size_t i = 0; i * PAGE_SIZE < n; i++) {
+        pages[i].store(map + i * PAGE_SIZE, std::memory_order_relaxed);
+    }
+}
+
+// ELF32 little-endian image: copy each PT_LOAD segment to its physical
+// load address (bss is already zero). The entry point is not used; the
+// core always starts at PC 0.
+bool Memory::load_elf(const unsigned char *data, size_t size) {
+    if (size < sizeof(Elf32_Ehdr)) return false;
+    const Elf32_Ehdr *eh = reinterpret_cast<const Elf32_Ehdr *>(data);
+    if (eh->e_ident[EI_CLASS] != ELFCLASS32 || eh->e_ident[EI_DATA] != ELFDATA2LSB) {
+        std::fprintf(stderr, "mem_init: only little-endian ELF32 images are supported\n");
+        return false;
+    }
+    if (eh->e_phentsize != sizeof(Elf32_Phdr) ||
+        eh->e_phoff + static_cast<size_t>(eh->e_phnum) * sizeof(Elf32_Phdr) > size) {
+        std::fprintf(stderr, "mem_init: bad ELF program header table\n");
+        return false;
+    }
+    const Elf32_Phdr *ph = reinterpret_cast<const Elf32_Phdr *>(data + eh->e_phoff);
+    for (int i = 0; i < eh->e_phnum; i++) {
+        if (ph[i].p_type != PT_LOAD || ph[i].p_filesz == 0) continue;
+        uint32_t addr = ph[i].p_paddr;
+        uint32_t len = ph[i].p_filesz;
+        if (ph[i].p_offset + static_cast<size_t>(len) > size ||
+            static_cast<uint64_t>(addr) + len > MEM_SIZE) {
+            std::fprintf(stderr, "mem_init: skipping ELF segment %d at 0x%08x\n", i, addr);
+            continue;
+        }
+        const unsigned char *src = data + ph[i].p_offset;
+        while (len) {
+            uint32_t off = addr & (PAGE_SIZE - 1);
+            uint32_t chunk = PAGE_SIZE - off < len ? PAGE_SIZE - off : len;
+            std::memcpy(get_page(addr) + off, src, chunk);
+            addr += chunk;
+            src += chunk;
+            len -= chunk;
+        }
+    }
+    return true;
+}
+
+static bool has_suffix(const char *s, const char *suffix) {
+    size_t n = std::strlen(s);
+    size_t m = std::strlen(suffix);
+    return n >= m && std::strcmp(s + n - m, suffix) == 0;
+}
+
+bool Memory::load(const char *path) {
+    clear();
+    is_initialized = true;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        std::perror("mem_init open");
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        std::perror("mem_init fstat");
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    // Writable private mapping: raw binaries keep it as their backing pages
+    void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        std::perror("mem_init mmap");
+        return false;
+    }
+    unsigned char *data = static_cast<unsigned char *>(map);
+
+    bool ok = true;
+    if (size >= SELFMAG && std::memcmp(data, ELFMAG, SELFMAG) == 0) {
+        ok = load_elf(data, size);
+    } else if (has_suffix(path, ".bin")) {
+        map_binary(data, size);
+        return true;
+    } else {
+        load_hex(reinterpret_cast<const char *>(data), size);
+    }
+    munmap(map, size);
+    return ok;
+}
+
+// Key for the Memory* stored as user data on bound DPI scopes
+static int scope_key;
+
+bool Memory::bind(const char *scope) {
+    svScope s = svGetScopeFromName(scope);
+    if (!s) {
+        std::fprintf(stderr, "Memory::bind: no DPI scope named %s\n", scope);
+        return false;
+    }
+    return svPutUserData(s, &scope_key, this) == 0;
+}
+
+// Memory for the DPI call in progress
+static inline Memory &scope_memory() {
+    svScope s = svGetScope();
+    if (s) {
+        void *m = svGetUserData(s, &scope_key);
+        if (m) return *static_cast<Memory *>(m);
+    }
+    return Memory::global();
+}
+
+extern "C" void *mem_attach(const char *path) {
+    Memory &m = scope_memory();
+    if (!m.initialized()) m.load(path && path[0] ? path : "imem.hex");
+    return &m;
+}
+
+// Handle-based accessors: no scope lookup. A null handle (attach never
+// ran) means the global memory.
+static inline Memory &handle_memory(void *mem) {
+    return mem ? *static_cast<Memory *>(mem) : Memory::global();
+}
+
+extern "C" int mem_read_h(void *mem, int raddr) {
+    return static_cast<int>(handle_memory(mem).read(static_cast<uint32_t>(raddr)));
+}
+
+extern "C" void mem_write_h(void *mem, int waddr, int wdata, unsigned char wmask) {
+    handle_memory(mem).write(static_cast<uint32_t>(waddr), static_cast<uint32_t>(wdata), wmask);
+}
+
+extern "C" void mem_init(const char *path) {
+    Memory &m = scope_memory();
+    if (m.initialized()) return;
+    m.load(path && path[0] ? path : "imem.hex");
 }
 
 extern "C" int mem_read(int raddr) {
-    if (!initialized) mem_init(nullptr);
-    uint32_t a = clamp_addr(static_cast<uint32_t>(raddr));
-    uint32_t word = 0;
-    word |= static_cast<uint32_t>(memory[a + 0]) << 0;
-    word |= static_cast<uint32_t>(memory[a + 1]) << 8;
-    word |= static_cast<uint32_t>(memory[a + 2]) << 16;
-    word |= static_cast<uint32_t>(memory[a + 3]) << 24;
-    return static_cast<int>(word);
+    Memory &m = scope_memory();
+    if (!m.initialized()) m.load("imem.hex");
+    return static_cast<int>(m.read(static_cast<uint32_t>(raddr)));
 }
 
 extern "C" void mem_write(int waddr, int wdata, unsigned char wmask) {
-    if (!initialized) mem_init(nullptr);
-    uint32_t a = clamp_addr(static_cast<uint32_t>(waddr));
-    uint32_t data = static_cast<uint32_t>(wdata);
-    if (wmask & 0x1) memory[a + 0] = (data >> 0) & 0xFF;
-    if (wmask & 0x2) memory[a + 1] = (data >> 8) & 0xFF;
-    if (wmask & 0x4) memory[a + 2] = (data >> 16) & 0xFF;
-    if (wmask & 0x8) memory[a + 3] = (data >> 24) & 0xFF;
+    Memory &m = scope_memory();
+    if (!m.initialized()) m.load("imem.hex");
+    m.write(static_cast<uint32_t>(waddr), static_cast<uint32_t>(wdata), wmask);
 }
@@ -4,11 +4,147 @@
 #define MEM_SIZE (128 * 1024 * 1024)
 
 #ifdef __cplusplus
+#include <stddef.h>
+#include <stdio.h>
+#include <atomic>
+
+// One simulated memory of MEM_SIZE bytes. Addresses are word-aligned and
+// clamped to the last word, as the DPI functions always did. Storage is
+// 4 KiB pages allocated on first write; reads of untouched pages are 0.
+// Any number of instances can exist: the testbench gives the golden model
+// its own, and binds one (or several) to RTL instance scopes below.
+// read() and write() may be called from several threads at once (a
+// --threads model built with --threads-dpi all); load, clear, copy and
+// the checkpoint functions must not overlap with any other access.
+class Memory {
+public:
+    static const uint32_t PAGE_BITS = 12;
+    static const uint32_t PAGE_SIZE = 1u << PAGE_BITS;
+    static const uint32_t NUM_PAGES = MEM_SIZE >> PAGE_BITS;
+
+    Memory();
+    ~Memory();
+    Memory(const Memory&) = delete;
+    Memory& operator=(const Memory&) = delete;
+
+    // Replace the contents with a program image (see mem_init for formats)
+    bool load(const char *path);
+    // True once load() has been attempted
+    bool initialized() const { return is_initialized; }
+    // Drop every page; the memory reads as all zeros
+    void clear();
+
+    // Checkpoint support: write every page that holds data (u32 count,
+    // then u32 page number + PAGE_SIZE bytes per page), or replace the
+    // contents with such a dump
+    bool save_pages(FILE *fp) const;
+    bool load_pages(FILE *fp);
+    // Replace the contents with a copy of another memory's pages
+    void copy_from(const Memory &other);
+
+    uint32_t read(uint32_t addr) const {
+        uint32_t a = clamp_addr(addr);
+        const unsigned char *p = find_page(a);
+        if (!p) return 0;
+        p += a & (PAGE_SIZE - 1);
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    // Write the bytes of data selected by mask (bit 0 -> byte 0, LSB)
+    void write(uint32_t addr, uint32_t data, uint8_t mask) {
+        if (!(mask & 0xF)) return;
+        uint32_t a = clamp_addr(addr);
+        unsigned char *p = get_page(a) + (a & (PAGE_SIZE - 1));
+        if (mask & 0x1) p[0] = (data >> 0) & 0xFF;
+        if (mask & 0x2) p[1] = (data >> 8) & 0xFF;
+        if (mask & 0x4) p[2] = (data >> 16) & 0xFF;
+        if (mask & 0x8) p[3] = (data >> 24) & 0xFF;
+    }
+
+    // Serve the DPI calls made from an RTL instance, e.g. "TOP.core.fetch_inst".
+    // Call after constructing the Verilated model and before the first eval.
+    bool bind(const char *scope);
+
+    // Memory behind DPI calls from scopes with no bound instance
+    static Memory &global();
+
+    static uint32_t clamp_addr(uint32_t addr) {
+        // Word-align and clamp to MEM_SIZE-4 (avoid overflow on last word)
+        uint32_t aligned = addr & ~0x3u;
+        if (aligned >= MEM_SIZE - 4) return (MEM_SIZE - 4);
+        return aligned;
+    }
+
+private:
+    typedef std::atomic<unsigned char *> PageSlot;
+    PageSlot *pages;            // NUM_PAGES entries, nullptr = never written
+    uint64_t id;                // changes whenever existing pages are dropped
+    // Last page touched, per thread and per instance: consecutive fetches
+    // and accesses to the same data structure almost always hit it. Entries
+    // are indexed by instance id, so the golden model's memory and the
+    // DUT's, used in turn on one thread, keep separate entries.
+    struct PageCache {
+        uint64_t id;
+        uint32_t num;
+        unsigned char *page;
+    };
+    static const uint32_t PAGE_CACHE_ENTRIES = 8;
+    static inline thread_local PageCache last[PAGE_CACHE_ENTRIES] = {};
+
+    PageCache &cached() const { return last[id % PAGE_CACHE_ENTRIES]; }
+
+    // Raw binary image mapped MAP_PRIVATE: its pages point straight into
+    // the mapping and are copied by the kernel only when written
+    unsigned char *image_map;
+    size_t image_size;
+    bool is_initialized;
+
+    // Page holding a (clamped) address, or nullptr if never written
+    unsigned char *find_page(uint32_t a) const {
+        uint32_t num = a >> PAGE_BITS;
+        PageCache &c = cached();
+        if (c.id == id && c.num == num) return c.page;
+        unsigned char *p = pages[num].load(std::memory_order_acquire);
+        if (p) c = {id, num, p};
+        return p;
+    }
+
+    // Page holding a (clamped) address, allocated on first use
+    unsigned char *get_page(uint32_t a) {
+        unsigned char *p = find_page(a);
+        return p ? p : alloc_page(a >> PAGE_BITS);
+    }
+
+    unsigned char *alloc_page(uint32_t num);
+    void load_hex(const char *text, size_t size);
+    void map_binary(unsigned char *map, size_t size);
+    bool load_elf(const unsigned char *data, size_t size);
+};
+
 extern "C" {
 #endif
 
-// Initialize memory from a hex file (one 32-bit word per line, little-endian layout).
-// If path is null, defaults to "imem.hex".
+// DPI entry points. The RTL uses the handle functions: mem_attach (a
+// context import, called once from an initial block) returns the Memory
+// bound to the calling instance scope, or Memory::global() when none is
+// bound, and loads it if it wasn't yet. mem_read_h/mem_write_h then take
+// that handle and skip the per-call scope lookup. Neither may be imported
+// pure: mem_read_h returns memory that mem_write_h changes, so a pure
+// read could be reused across a store.
+// mem_init/mem_read/mem_write resolve the scope on every call (context
+// imports) and remain for simple testbenches.
+
+// Memory for the calling scope, initialized from path (see mem_init)
+void *mem_attach(const char *path);
+int mem_read_h(void *mem, int raddr);
+void mem_write_h(void *mem, int waddr, int wdata, unsigned char wmask);
+
+// Initialize memory from a program image, once per Memory. If path is
+// null, defaults to "imem.hex".
+//   ELF32 (detected by magic)  PT_LOAD segments copied to their load addresses
+//   *.bin                      raw little-endian bytes mapped at address 0
+//   anything else              hex, one 32-bit word per line from address 0
 void mem_init(const char *path);
 
 // Read a 32-bit word from an address (word-aligned internally).
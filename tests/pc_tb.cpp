@@ -8,6 +8,7 @@ int main(int argc, char** argv){
     auto* top = new Vpc;          // Create instance of the top module
     top->clk = 0;                  // Initialize clock
     top->rst = 1;                // Start with reset active
+    top->load_enable = 0;          // No checkpoint load
     top->eval();                   // Initial evaluation with reset
     top->rst = 0;                // Deactivate reset
     const int sim_cycles = 20;     // Number of clock cycles to simulate
@@ -21,6 +22,15 @@ int main(int argc, char** argv){
         top->clk = 0;
         top->eval();               // Evaluate with clock low
     }
+    // Checkpoint load: the PC takes load_value on the next edge
+    top->load_enable = 1;
+    top->load_value = 0x6500;
+    top->clk = 1;
+    top->eval();
+    std::cout << "Load:     PC = 0x" << std::hex << top->pc_out << std::dec << std::endl;
+    top->clk = 0;
+    top->load_enable = 0;
+    top->eval();
     delete top;                    // Clean up
     return 0;
 }
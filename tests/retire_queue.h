@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+// Bounded single-producer/single-consumer ring buffer.
+// One thread may call push(), one other thread may call pop(); no locks.
+// Each side keeps a cached copy of the other side's index and only
+// re-reads the shared atomic when the ring looks full/empty, so the two
+// cores don't bounce the index cache lines on every element.
+template <typename T, size_t CAPACITY>
+class RetireQueue {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+public:
+    RetireQueue() : head(0), tail(0), cached_head(0), cached_tail(0), closed(false) {}
+
+    // Producer: block (yielding) until there is room, then enqueue.
+    // Returns false if the consumer closed the queue.
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        while (t - cached_head == CAPACITY) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head != CAPACITY) break;
+            if (closed.load(std::memory_order_relaxed)) return false;
+            std::this_thread::yield();
+        }
+        slots[t & (CAPACITY - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: block (yielding) until an item is available.
+    // Returns false once the producer has finished and the ring is empty.
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        while (h == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (h != cached_tail) break;
+            if (closed.load(std::memory_order_acquire)) {
+                // Re-check: the producer may have pushed before closing
+                cached_tail = tail.load(std::memory_order_acquire);
+                if (h != cached_tail) break;
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        item = slots[h & (CAPACITY - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Either side: no more items will be pushed/popped
+    void close() {
+        closed.store(true, std::memory_order_release);
+    }
+
+private:
+    // Producer- and consumer-owned fields on separate cache lines
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+    alignas(64) size_t cached_head;     // producer's view of head
+    alignas(64) size_t cached_tail;     // consumer's view of tail
+    alignas(64) std::atomic<bool> closed;
+    T slots[CAPACITY];
+};
@@ -0,0 +1,252 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Binary retirement trace: what each retired instruction changed, in
+// program order. Written by golden_model --retire-trace=PATH and core_tb
+// --retire-trace PATH, compared by trace_diff. Stores use the RTL's lane
+// convention (word address, byte mask, data in its lanes), so traces
+// from the core and from either golden model compare byte for byte.
+//
+//   header   "RVRT" then one version byte (1)
+//   record   tag byte, then the fields its bits select, in this order
+//     tag bit 0     jump: a zigzag LEB128 varint follows, next_pc minus
+//                   (the previous record's next_pc + 4); clear means
+//                   next_pc = previous + 4 (the first record's previous
+//                   next_pc is 0)
+//     tag bit 1     register write: rd (one byte), then the value as an
+//                   LEB128 varint
+//     tag bit 2     store: the word address minus the previous store's,
+//                   divided by 4, as a zigzag varint; then the data with
+//                   unselected bytes zeroed, as a varint
+//     tag bit 3     0
+//     tag bits 7:4  store byte mask
+//
+// Straight-line ALU code costs two to six bytes per instruction.
+struct RetireTraceRecord {
+    uint32_t next_pc;
+    bool we;            // register write (never x0)
+    uint8_t rd;
+    uint32_t wdata;
+    bool mem_we;        // store: bytes of mem_data selected by mem_mask
+    uint8_t mem_mask;
+    uint32_t mem_addr;  // word aligned
+    uint32_t mem_data;
+
+    bool operator==(const RetireTraceRecord& o) const {
+        return next_pc == o.next_pc && we == o.we && (!we || (rd == o.rd && wdata == o.wdata)) &&
+               mem_we == o.mem_we &&
+               (!mem_we || (mem_mask == o.mem_mask && mem_addr == o.mem_addr &&
+                            mem_data == o.mem_data));
+    }
+    bool operator!=(const RetireTraceRecord& o) const { return !(*this == o); }
+};
+
+class RetireTraceWriter {
+public:
+    RetireTraceWriter() : fp(nullptr), len(0), count(0), buf(BUF_SIZE) {}
+    ~RetireTraceWriter() { close(); }
+    RetireTraceWriter(const RetireTraceWriter&) = delete;
+    RetireTraceWriter& operator=(const RetireTraceWriter&) = delete;
+
+    bool open(const char* path) {
+        close();
+        fp = std::fopen(path, "wb");
+        if (!fp) {
+            std::perror("RetireTraceWriter fopen");
+            return false;
+        }
+        static const uint8_t header[5] = {'R', 'V', 'R', 'T', 1};
+        std::fwrite(header, 1, sizeof(header), fp);
+        prev_pc = 0;
+        prev_addr = 0;
+        count = 0;
+        return true;
+    }
+
+    bool is_open() const { return fp != nullptr; }
+    uint64_t records() const { return count; }
+
+    // Stores are normalised here: the address is word aligned and bytes
+    // outside the mask are dropped
+    void write(const RetireTraceRecord& r) {
+        if (len > BUF_SIZE - MAX_RECORD) flush();
+        uint8_t* p = &buf[len];
+        size_t n = 1;
+        uint8_t tag = 0;
+        if (r.next_pc != prev_pc + 4) {
+            tag |= 0x1;
+            n += put_varint(p + n, zigzag(r.next_pc - (prev_pc + 4)));
+        }
+        prev_pc = r.next_pc;
+        if (r.we) {
+            tag |= 0x2;
+            p[n++] = r.rd & 0xF;
+            n += put_varint(p + n, r.wdata);
+        }
+        if (r.mem_we) {
+            uint32_t addr = r.mem_addr & ~0x3u;
+            tag |= 0x4 | ((r.mem_mask & 0xF) << 4);
+            n += put_varint(p + n, zigzag(static_cast<uint32_t>(
+                                       static_cast<int32_t>(addr - prev_addr) >> 2)));
+            n += put_varint(p + n, r.mem_data & lane_mask(r.mem_mask));
+            prev_addr = addr;
+        }
+        p[0] = tag;
+        len += n;
+        count++;
+    }
+
+    // Flush and close; true if every write succeeded
+    bool close() {
+        if (!fp) return true;
+        flush();
+        bool ok = !std::ferror(fp);
+        ok = std::fclose(fp) == 0 && ok;
+        fp = nullptr;
+        return ok;
+    }
+
+private:
+    static const size_t BUF_SIZE = 1 << 20;
+    static const size_t MAX_RECORD = 22;
+
+    FILE* fp;
+    size_t len;
+    uint64_t count;
+    std::vector<uint8_t> buf;
+    uint32_t prev_pc;
+    uint32_t prev_addr;
+
+    static uint32_t zigzag(uint32_t v) {
+        return (v << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(v) >> 31);
+    }
+
+    static uint32_t lane_mask(uint8_t mask) {
+        return ((mask & 0x1) ? 0x000000FFu : 0) | ((mask & 0x2) ? 0x0000FF00u : 0) |
+               ((mask & 0x4) ? 0x00FF0000u : 0) | ((mask & 0x8) ? 0xFF000000u : 0);
+    }
+
+    static size_t put_varint(uint8_t* p, uint32_t v) {
+        size_t n = 0;
+        while (v >= 0x80) {
+            p[n++] = static_cast<uint8_t>(v | 0x80);
+            v >>= 7;
+        }
+        p[n++] = static_cast<uint8_t>(v);
+        return n;
+    }
+
+    void flush() {
+        if (len) std::fwrite(buf.data(), 1, len, fp);
+        len = 0;
+    }
+};
+
+class RetireTraceReader {
+public:
+    RetireTraceReader()
+        : fp(nullptr), pos(0), len(0), eof(false), bad(false), buf(BUF_SIZE) {}
+    ~RetireTraceReader() { if (fp) std::fclose(fp); }
+    RetireTraceReader(const RetireTraceReader&) = delete;
+    RetireTraceReader& operator=(const RetireTraceReader&) = delete;
+
+    bool open(const char* path) {
+        fp = std::fopen(path, "rb");
+        if (!fp) {
+            std::perror("RetireTraceReader fopen");
+            return false;
+        }
+        uint8_t header[5];
+        if (std::fread(header, 1, sizeof(header), fp) != sizeof(header) ||
+            header[0] != 'R' || header[1] != 'V' || header[2] != 'R' || header[3] != 'T' ||
+            header[4] != 1) {
+            std::fprintf(stderr, "RetireTraceReader: %s is not a version 1 retirement trace\n",
+                         path);
+            return false;
+        }
+        prev_pc = 0;
+        prev_addr = 0;
+        return true;
+    }
+
+    // Next record; false at the end of the trace or on a corrupt record
+    bool next(RetireTraceRecord& r) {
+        if (len - pos < MAX_RECORD && !eof) refill();
+        if (pos == len) return false;
+        uint8_t tag = buf[pos++];
+        uint32_t v;
+        if (tag & 0x8) return fail();
+        r.next_pc = prev_pc + 4;
+        if (tag & 0x1) {
+            if (!get_varint(v)) return fail();
+            r.next_pc += unzigzag(v);
+        }
+        prev_pc = r.next_pc;
+        r.we = (tag & 0x2) != 0;
+        r.rd = 0;
+        r.wdata = 0;
+        if (r.we) {
+            if (pos == len) return fail();
+            r.rd = buf[pos++];
+            if (!get_varint(r.wdata)) return fail();
+        }
+        r.mem_we = (tag & 0x4) != 0;
+        r.mem_mask = r.mem_we ? tag >> 4 : 0;
+        r.mem_addr = 0;
+        r.mem_data = 0;
+        if (r.mem_we) {
+            if (!get_varint(v)) return fail();
+            prev_addr += unzigzag(v) << 2;
+            r.mem_addr = prev_addr;
+            if (!get_varint(r.mem_data)) return fail();
+        }
+        return true;
+    }
+
+    // The last next() stopped at a truncated or malformed record
+    bool corrupt() const { return bad; }
+
+private:
+    static const size_t BUF_SIZE = 1 << 20;
+    static const size_t MAX_RECORD = 22;
+
+    FILE* fp;
+    size_t pos, len;
+    bool eof;
+    bool bad;
+    std::vector<uint8_t> buf;
+    uint32_t prev_pc;
+    uint32_t prev_addr;
+
+    static uint32_t unzigzag(uint32_t z) { return (z >> 1) ^ (0u - (z & 1)); }
+
+    bool get_varint(uint32_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (pos == len) return false;
+            uint8_t b = buf[pos++];
+            v |= static_cast<uint32_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    bool fail() {
+        bad = true;
+        pos = len;
+        eof = true;
+        return false;
+    }
+
+    void refill() {
+        size_t left = len - pos;
+        for (size_t i = 0; i < left; i++) buf[i] = buf[pos + i];
+        pos = 0;
+        len = left;
+        size_t n = std::fread(&buf[len], 1, BUF_SIZE - len, fp);
+        len += n;
+        if (n == 0) eof = true;
+    }
+};
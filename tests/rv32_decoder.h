@@ -0,0 +1,263 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// RV32 instruction decoder shared by golden_model.cpp, tests/core_tb.cpp
+// and the debug tools. Decoding is one lookup in a table built at compile
+// time, indexed by opcode, funct3 and funct7, plus field extraction;
+// callers map the resulting op to their own handlers.
+
+// RV32I operations. tests/core_profile.h and rtl/perf_counters.sv count
+// retired instructions in this order, and rtl/decoder.sv numbers its
+// op_class output the same way.
+enum Rv32Op : uint8_t {
+    RV32_ADD,
+    RV32_ADDI,
+    RV32_LUI,
+    RV32_LW,
+    RV32_LBU,
+    RV32_SW,
+    RV32_SB,
+    RV32_JALR,
+    RV32_SUB,
+    RV32_SLL,
+    RV32_SLT,
+    RV32_SLTU,
+    RV32_XOR,
+    RV32_SRL,
+    RV32_SRA,
+    RV32_OR,
+    RV32_AND,
+    RV32_SLTI,
+    RV32_SLTIU,
+    RV32_XORI,
+    RV32_ORI,
+    RV32_ANDI,
+    RV32_SLLI,
+    RV32_SRLI,
+    RV32_SRAI,
+    RV32_AUIPC,
+    RV32_JAL,
+    RV32_BEQ,
+    RV32_BNE,
+    RV32_BLT,
+    RV32_BGE,
+    RV32_BLTU,
+    RV32_BGEU,
+    RV32_LB,
+    RV32_LH,
+    RV32_LHU,
+    RV32_SH,
+    RV32_OTHER,         // FENCE/ECALL/EBREAK and unknown encodings, executed as NOP
+    RV32_NUM_OPS
+};
+
+static const char* const RV32_OP_NAMES[RV32_NUM_OPS] = {
+    "add", "addi", "lui", "lw", "lbu", "sw", "sb", "jalr",
+    "sub", "sll", "slt", "sltu", "xor", "srl", "sra", "or", "and",
+    "slti", "sltiu", "xori", "ori", "andi", "slli", "srli", "srai",
+    "auipc", "jal", "beq", "bne", "blt", "bge", "bltu", "bgeu",
+    "lb", "lh", "lhu", "sh", "other"
+};
+
+// Decoded instruction. imm is already in the op's own format: sign-extended
+// I, S, B or J immediate, U immediate << 12, or the shift amount.
+struct Rv32Decoded {
+    Rv32Op op;
+    uint8_t rd, rs1, rs2;
+    int32_t imm;
+};
+
+namespace rv32_detail {
+
+// Major opcodes, instr[6:0]
+constexpr uint32_t OPC_LOAD   = 0b0000011;
+constexpr uint32_t OPC_MISC   = 0b0001111;
+constexpr uint32_t OPC_OP_IMM = 0b0010011;
+constexpr uint32_t OPC_AUIPC  = 0b0010111;
+constexpr uint32_t OPC_STORE  = 0b0100011;
+constexpr uint32_t OPC_OP     = 0b0110011;
+constexpr uint32_t OPC_LUI    = 0b0110111;
+constexpr uint32_t OPC_BRANCH = 0b1100011;
+constexpr uint32_t OPC_JALR   = 0b1100111;
+constexpr uint32_t OPC_JAL    = 0b1101111;
+
+// Table index: opcode in bits [6:0], funct3 in [9:7], instr[30] (the only
+// funct7 bit RV32I uses) in [10], and whether any other funct7 bit is set
+// in [11]
+constexpr uint32_t KEY_BITS = 12;
+
+constexpr uint32_t key(uint32_t instr) {
+    return (instr & 0x7F) | ((instr >> 5) & 0x380) | ((instr >> 20) & 0x400) |
+           (static_cast<uint32_t>((instr & 0xBE000000) != 0) << 11);
+}
+
+constexpr Rv32Op classify(uint32_t opcode, uint32_t funct3, bool alt, bool funct7_other) {
+    constexpr Rv32Op X = RV32_OTHER;
+    switch (opcode) {
+        case OPC_OP: {
+            if (funct7_other) return X;
+            constexpr Rv32Op base[8] = {RV32_ADD, RV32_SLL, RV32_SLT, RV32_SLTU,
+                                        RV32_XOR, RV32_SRL, RV32_OR, RV32_AND};
+            constexpr Rv32Op with_alt[8] = {RV32_SUB, X, X, X, X, RV32_SRA, X, X};
+            return alt ? with_alt[funct3] : base[funct3];
+        }
+        case OPC_OP_IMM: {
+            // Shift immediates keep a funct7 in imm[11:5]; the rest is all immediate
+            if (funct3 == 0b001) return (alt || funct7_other) ? X : RV32_SLLI;
+            if (funct3 == 0b101) return funct7_other ? X : alt ? RV32_SRAI : RV32_SRLI;
+            constexpr Rv32Op ops[8] = {RV32_ADDI, X, RV32_SLTI, RV32_SLTIU,
+                                       RV32_XORI, X, RV32_ORI, RV32_ANDI};
+            return ops[funct3];
+        }
+        case OPC_LOAD: {
+            constexpr Rv32Op ops[8] = {RV32_LB, RV32_LH, RV32_LW, X, RV32_LBU, RV32_LHU, X, X};
+            return ops[funct3];
+        }
+        case OPC_STORE: {
+            constexpr Rv32Op ops[8] = {RV32_SB, RV32_SH, RV32_SW, X, X, X, X, X};
+            return ops[funct3];
+        }
+        case OPC_BRANCH: {
+            constexpr Rv32Op ops[8] = {RV32_BEQ, RV32_BNE, X, X,
+                                       RV32_BLT, RV32_BGE, RV32_BLTU, RV32_BGEU};
+            return ops[funct3];
+        }
+        case OPC_LUI:   return RV32_LUI;
+        case OPC_AUIPC: return RV32_AUIPC;
+        case OPC_JAL:   return RV32_JAL;
+        case OPC_JALR:  return funct3 == 0 ? RV32_JALR : X;
+        case OPC_MISC:  return X;   // FENCE: nothing to order in this core
+        default:        return X;
+    }
+}
+
+constexpr std::array<Rv32Op, 1u << KEY_BITS> make_op_table() {
+    std::array<Rv32Op, 1u << KEY_BITS> t{};
+    for (uint32_t k = 0; k < t.size(); k++) {
+        t[k] = classify(k & 0x7F, (k >> 7) & 0x7, (k >> 10) & 1, (k >> 11) & 1);
+    }
+    return t;
+}
+
+inline constexpr std::array<Rv32Op, 1u << KEY_BITS> OP_TABLE = make_op_table();
+
+// Operand layout per op: which immediate it takes and how it disassembles
+enum Format : uint8_t {
+    FMT_R,              // op rd, rs1, rs2
+    FMT_I,              // op rd, rs1, imm
+    FMT_SHIFT,          // op rd, rs1, shamt
+    FMT_U,              // op rd, 0xupper
+    FMT_LOAD,           // op rd, imm(rs1)  (also JALR)
+    FMT_STORE,          // op rs2, imm(rs1)
+    FMT_BRANCH,         // op rs1, rs2, offset
+    FMT_JAL,            // op rd, offset
+    FMT_NONE
+};
+
+constexpr Format FORMATS[RV32_NUM_OPS] = {
+    FMT_R, FMT_I, FMT_U, FMT_LOAD, FMT_LOAD, FMT_STORE, FMT_STORE, FMT_LOAD,
+    FMT_R, FMT_R, FMT_R, FMT_R, FMT_R, FMT_R, FMT_R, FMT_R, FMT_R,
+    FMT_I, FMT_I, FMT_I, FMT_I, FMT_I, FMT_SHIFT, FMT_SHIFT, FMT_SHIFT,
+    FMT_U, FMT_JAL, FMT_BRANCH, FMT_BRANCH, FMT_BRANCH, FMT_BRANCH, FMT_BRANCH, FMT_BRANCH,
+    FMT_LOAD, FMT_LOAD, FMT_LOAD, FMT_STORE, FMT_NONE
+};
+
+constexpr int32_t imm_i(uint32_t instr) {
+    return static_cast<int32_t>(instr) >> 20;
+}
+
+constexpr int32_t imm_s(uint32_t instr) {
+    return ((static_cast<int32_t>(instr) >> 20) & ~0x1F) | ((instr >> 7) & 0x1F);
+}
+
+constexpr int32_t imm_b(uint32_t instr) {
+    return ((static_cast<int32_t>(instr) >> 19) & ~0xFFF) | ((instr << 4) & 0x800) |
+           ((instr >> 20) & 0x7E0) | ((instr >> 7) & 0x1E);
+}
+
+constexpr int32_t imm_j(uint32_t instr) {
+    return ((static_cast<int32_t>(instr) >> 11) & ~0xFFFFF) | (instr & 0xFF000) |
+           ((instr >> 9) & 0x800) | ((instr >> 20) & 0x7FE);
+}
+
+constexpr int32_t immediate(Format fmt, uint32_t instr) {
+    switch (fmt) {
+        case FMT_SHIFT:  return (instr >> 20) & 0x1F;
+        case FMT_U:      return static_cast<int32_t>(instr & 0xFFFFF000);
+        case FMT_STORE:  return imm_s(instr);
+        case FMT_BRANCH: return imm_b(instr);
+        case FMT_JAL:    return imm_j(instr);
+        default:         return imm_i(instr);
+    }
+}
+
+}  // namespace rv32_detail
+
+inline constexpr Rv32Op rv32_op(uint32_t instr) {
+    return rv32_detail::OP_TABLE[rv32_detail::key(instr)];
+}
+
+inline constexpr Rv32Decoded rv32_decode(uint32_t instr) {
+    Rv32Op op = rv32_op(instr);
+    return Rv32Decoded{
+        op,
+        static_cast<uint8_t>((instr >> 7) & 0x1F),
+        static_cast<uint8_t>((instr >> 15) & 0x1F),
+        static_cast<uint8_t>((instr >> 20) & 0x1F),
+        rv32_detail::immediate(rv32_detail::FORMATS[op], instr)
+    };
+}
+
+// True if the op writes rd (a write to x0 still counts here)
+inline constexpr bool rv32_writes_rd(Rv32Op op) {
+    using namespace rv32_detail;
+    return FORMATS[op] != FMT_STORE && FORMATS[op] != FMT_BRANCH && FORMATS[op] != FMT_NONE;
+}
+
+// True if the op can change control flow (block boundary for the JIT)
+inline constexpr bool rv32_is_jump(Rv32Op op) {
+    using namespace rv32_detail;
+    return op == RV32_JALR || FORMATS[op] == FMT_JAL || FORMATS[op] == FMT_BRANCH;
+}
+
+// Assembly text, e.g. "addi x1, x0, 5" or "sw x2, 8(x1)". Branch and JAL
+// offsets are printed relative to the instruction's own PC.
+inline std::string rv32_disasm(uint32_t instr) {
+    using namespace rv32_detail;
+    Rv32Decoded d = rv32_decode(instr);
+    const char* name = RV32_OP_NAMES[d.op];
+    char buf[64];
+    switch (FORMATS[d.op]) {
+        case FMT_R:
+            std::snprintf(buf, sizeof(buf), "%s x%u, x%u, x%u", name, d.rd, d.rs1, d.rs2);
+            break;
+        case FMT_I:
+        case FMT_SHIFT:
+            std::snprintf(buf, sizeof(buf), "%s x%u, x%u, %d", name, d.rd, d.rs1, d.imm);
+            break;
+        case FMT_U:
+            std::snprintf(buf, sizeof(buf), "%s x%u, 0x%x", name, d.rd,
+                          static_cast<uint32_t>(d.imm) >> 12);
+            break;
+        case FMT_LOAD:
+            std::snprintf(buf, sizeof(buf), "%s x%u, %d(x%u)", name, d.rd, d.imm, d.rs1);
+            break;
+        case FMT_STORE:
+            std::snprintf(buf, sizeof(buf), "%s x%u, %d(x%u)", name, d.rs2, d.imm, d.rs1);
+            break;
+        case FMT_BRANCH:
+            std::snprintf(buf, sizeof(buf), "%s x%u, x%u, %+d", name, d.rs1, d.rs2, d.imm);
+            break;
+        case FMT_JAL:
+            std::snprintf(buf, sizeof(buf), "%s x%u, %+d", name, d.rd, d.imm);
+            break;
+        default:
+            std::snprintf(buf, sizeof(buf), "unsupported (opcode=0x%02x, funct3=%u, funct7=0x%02x)",
+                          instr & 0x7F, (instr >> 12) & 0x7, instr >> 25);
+            break;
+    }
+    return buf;
+}
@@ -0,0 +1,105 @@
+/**
+ * Retirement trace differ: streams two traces written by golden_model
+ * --retire-trace=PATH or core_tb --retire-trace PATH (format in
+ * tests/retire_trace.h) and reports the first retirement where they
+ * diverge, with the records leading up to it.
+ *
+ *   trace_diff EXPECTED ACTUAL [--context N] [--prefix]
+ *
+ * Exits 0 when the traces are identical, 1 when they diverge or one is
+ * shorter, 2 on a usage or file error. --prefix accepts a shorter trace
+ * that matches the start of the other, as from an RTL run bounded by
+ * cycles rather than instructions. Memory use is constant: only the
+ * last N (default 5) records are kept.
+ */
+
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "tests/retire_trace.h"
+
+using namespace std;
+
+static void print_record(const string& label, const RetireTraceRecord& r) {
+    cout << "  " << label << ": next_pc=0x" << hex << setw(8) << setfill('0') << r.next_pc;
+    if (r.we) {
+        cout << ", x" << dec << unsigned(r.rd) << " <- 0x" << hex << setw(8) << r.wdata;
+    }
+    if (r.mem_we) {
+        cout << ", mem[0x" << setw(8) << r.mem_addr << "] <- 0x" << setw(8) << r.mem_data
+             << " mask=0x" << unsigned(r.mem_mask);
+    }
+    cout << dec << endl;
+}
+
+int main(int argc, char** argv) {
+    const char* paths[2] = {nullptr, nullptr};
+    int npaths = 0;
+    uint64_t context = 5;
+    bool prefix = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--context" && i + 1 < argc) {
+            context = stoull(argv[++i]);
+        } else if (arg == "--prefix") {
+            prefix = true;
+        } else if (npaths < 2 && arg[0] != '-') {
+            paths[npaths++] = argv[i];
+        } else {
+            npaths = 0;
+            break;
+        }
+    }
+    if (npaths != 2) {
+        cerr << "Usage: " << argv[0] << " EXPECTED ACTUAL [--context N] [--prefix]" << endl;
+        return 2;
+    }
+
+    RetireTraceReader expected, actual;
+    if (!expected.open(paths[0]) || !actual.open(paths[1])) return 2;
+
+    // Last `context` matching records, oldest overwritten first
+    vector<RetireTraceRecord> history(context);
+    uint64_t index = 0;
+    RetireTraceRecord e, a;
+    bool have_e, have_a;
+    for (;; index++) {
+        have_e = expected.next(e);
+        have_a = actual.next(a);
+        if (!have_e || !have_a || e != a) break;
+        if (context) history[index % context] = e;
+    }
+    if (expected.corrupt() || actual.corrupt()) {
+        cout << (expected.corrupt() ? paths[0] : paths[1]) << " is corrupt at retirement "
+             << index << endl;
+        return 1;
+    }
+    if (!have_e && !have_a) {
+        cout << "Traces match: " << index << " retirements" << endl;
+        return 0;
+    }
+    if (prefix && (!have_e || !have_a)) {
+        cout << "Traces match for the " << index << " retirements of "
+             << (have_e ? paths[1] : paths[0]) << endl;
+        return 0;
+    }
+
+    // index is the first retirement that differs or is missing
+    uint64_t shown = index < context ? index : context;
+    if (shown) cout << "Last " << shown << " matching retirements:" << endl;
+    for (uint64_t i = index - shown; i < index; i++) {
+        print_record("#" + to_string(i), history[i % context]);
+    }
+    if (!have_e || !have_a) {
+        cout << "First divergence at retirement " << index << ": "
+             << (have_e ? paths[1] : paths[0]) << " ends" << endl;
+        print_record(have_e ? "expected" : "actual", have_e ? e : a);
+    } else {
+        cout << "First divergence at retirement " << index << ":" << endl;
+        print_record("expected", e);
+        print_record("actual", a);
+    }
+    return 1;
+}